@@ -0,0 +1,105 @@
+#include "sgcl/sgcl.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace sgcl;
+
+struct Node {
+    int64_t value = 0;
+};
+
+// before C++20 the atomic functions for shared_ptr are used
+struct Shared {
+#if __cpp_lib_atomic_shared_ptr
+    std::shared_ptr<Node> load(std::memory_order m) const {
+        return _ptr.load(m);
+    }
+    void store(std::shared_ptr<Node> p, std::memory_order m) {
+        _ptr.store(std::move(p), m);
+    }
+    std::atomic<std::shared_ptr<Node>> _ptr;
+#else
+    std::shared_ptr<Node> load(std::memory_order m) const {
+        return std::atomic_load_explicit(&_ptr, m);
+    }
+    void store(std::shared_ptr<Node> p, std::memory_order m) {
+        std::atomic_store_explicit(&_ptr, std::move(p), m);
+    }
+    std::shared_ptr<Node> _ptr;
+#endif
+};
+
+static constexpr int Count = 1000000;
+
+// readers load the pointer and read the object while one thread replaces it
+template<class Load, class Store>
+static void run(const char* name, unsigned readers, Load&& load, Store&& store) {
+    using std::chrono::high_resolution_clock;
+    using std::chrono::duration;
+
+    std::atomic<bool> done = {false};
+    std::atomic<int64_t> sum = {0};
+    std::thread writer([&]{
+        while(!done.load(std::memory_order_relaxed)) {
+            store();
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    });
+    auto t = high_resolution_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < readers; ++i) {
+        threads.emplace_back([&]{
+            int64_t s = 0;
+            for (int i = 0; i < Count; ++i) {
+                s += load();
+            }
+            sum += s;
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto time = duration<double, std::nano>(high_resolution_clock::now() - t).count() / Count;
+    done = true;
+    writer.join();
+    std::cout << name << ": " << time << "ns\n";
+}
+
+int main() {
+    auto readers = std::max(std::thread::hardware_concurrency(), 1u);
+    std::cout << "readers: " << readers << std::endl;
+
+    atomic<root_ptr<Node>> sgcl_ptr = make_tracked<Node>();
+    auto sgcl_store = [&]{
+        sgcl_ptr.store(make_tracked<Node>(), std::memory_order_release);
+    };
+    run("sgcl load", readers, [&]{
+        return sgcl_ptr.load()->value;
+    }, sgcl_store);
+    run("sgcl load acquire", readers, [&]{
+        return sgcl_ptr.load(std::memory_order_acquire)->value;
+    }, sgcl_store);
+    run("sgcl load_unsafe", readers, [&]{
+        return sgcl_ptr.load_unsafe()->value;
+    }, sgcl_store);
+    run("sgcl load_unsafe acquire", readers, [&]{
+        return sgcl_ptr.load_unsafe(std::memory_order_acquire)->value;
+    }, sgcl_store);
+
+    Shared shared_ptr;
+    shared_ptr.store(std::make_shared<Node>(), std::memory_order_seq_cst);
+    auto shared_store = [&]{
+        shared_ptr.store(std::make_shared<Node>(), std::memory_order_release);
+    };
+    run("shared_ptr load", readers, [&]{
+        return shared_ptr.load(std::memory_order_seq_cst)->value;
+    }, shared_store);
+    run("shared_ptr load acquire", readers, [&]{
+        return shared_ptr.load(std::memory_order_acquire)->value;
+    }, shared_store);
+}
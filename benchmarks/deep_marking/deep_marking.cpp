@@ -0,0 +1,75 @@
+#include "sgcl/sgcl.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+using namespace sgcl;
+
+struct Node {
+    tracked_ptr<Node> left;
+    tracked_ptr<Node> right;
+    int64_t key = 0;
+};
+
+static constexpr size_t Size = 1000000;
+
+// a list linked in random order of allocation, each step of marking goes to another page
+static void build_list(tracked_ptr<Node>& head, std::mt19937_64& random) {
+    auto nodes = make_tracked<tracked_ptr<Node>[]>(Size);
+    std::vector<size_t> order(Size);
+    for (size_t i = 0; i < Size; ++i) {
+        nodes[i] = make_tracked<Node>();
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), random);
+    for (size_t i = 1; i < Size; ++i) {
+        nodes[order[i - 1]]->left = nodes[order[i]];
+    }
+    head = nodes[order[0]];
+}
+
+// a binary search tree of random keys, like the treap of the examples
+static void build_tree(tracked_ptr<Node>& root, std::mt19937_64& random) {
+    for (size_t i = 0; i < Size; ++i) {
+        auto key = (int64_t)random();
+        auto node = &root;
+        while (*node) {
+            node = key < (*node)->key ? &(*node)->left : &(*node)->right;
+        }
+        *node = make_tracked<Node>();
+        (*node)->key = key;
+    }
+}
+
+static void measure(const char* name) {
+    using std::chrono::high_resolution_clock;
+    using std::chrono::duration;
+
+    collector::force_collect(true);
+    static constexpr int Count = 10;
+    double mark_time = 0;
+    auto t = high_resolution_clock::now();
+    for (int i = 0; i < Count; ++i) {
+        collector::force_collect(true);
+        mark_time += collector::stats().last_mark_time;
+    }
+    std::cout << name << " collect: " << duration<double, std::milli>(high_resolution_clock::now() - t).count() / Count << "ms"
+              << ", mark: " << mark_time / Count << "ms\n";
+}
+
+int main() {
+    std::mt19937_64 random(42);
+    std::cout << "mark stack: " << SGCL_MARK_STACK << std::endl;
+    {
+        root_ptr<Node> list;
+        build_list(list, random);
+        measure("list");
+    }
+    {
+        root_ptr<Node> tree;
+        build_tree(tree, random);
+        measure("tree");
+    }
+}
@@ -0,0 +1,59 @@
+#include "sgcl/sgcl.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+using namespace sgcl;
+
+struct Node {
+    tracked_ptr<Node> child1;
+    tracked_ptr<Node> child2;
+    tracked_ptr<Node> child3;
+    tracked_ptr<Node> child4;
+    int64_t value = 0;
+};
+
+// builds a complete 4-ary tree; wide trees keep all marking threads busy
+static void build(tracked_ptr<Node>& node, int depth) {
+    node = make_tracked<Node>();
+    if (depth) {
+        build(node->child1, depth - 1);
+        build(node->child2, depth - 1);
+        build(node->child3, depth - 1);
+        build(node->child4, depth - 1);
+    }
+}
+
+// --row prints the results as one row of the markdown table written by run_parallel_marking
+int main(int argc, char** argv) {
+    using std::chrono::high_resolution_clock;
+    using std::chrono::duration;
+
+    bool row = argc > 1 && !strcmp(argv[1], "--row");
+
+    root_ptr<Node> root;
+    auto t = high_resolution_clock::now();
+    build(root, 11);
+    auto build_time = duration<double, std::milli>(high_resolution_clock::now() - t).count();
+
+    collector::force_collect(true);
+    auto live = collector::live_objects_number();
+
+    static constexpr int Count = 10;
+    t = high_resolution_clock::now();
+    for (int i = 0; i < Count; ++i) {
+        collector::force_collect(true);
+    }
+    auto collect_time = duration<double, std::milli>(high_resolution_clock::now() - t).count() / Count;
+
+    if (row) {
+        std::cout << "| " << SGCL_MARKING_THREADS << " | " << SGCL_MARKING_THREADS + 1 << " | " << live << " | "
+                  << build_time << " | " << collect_time << " |" << std::endl;
+    } else {
+        std::cout << "build: " << build_time << "ms\n";
+        std::cout << "live objects: " << live << std::endl;
+        std::cout << "marking threads: " << SGCL_MARKING_THREADS + 1 << std::endl;
+        std::cout << "collect: " << collect_time << "ms\n";
+    }
+}
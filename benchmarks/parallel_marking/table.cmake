@@ -0,0 +1,15 @@
+# runs parallel_marking_<count> for each count in COUNTS and writes the rows to parallel_marking.md
+string(REPLACE "," ";" COUNTS "${COUNTS}")
+set(table "| SGCL_MARKING_THREADS | markers | live objects | build ms | collect ms |\n")
+string(APPEND table "|---|---|---|---|---|\n")
+foreach(count ${COUNTS})
+    execute_process(COMMAND ${BINARY_DIR}/parallel_marking_${count} --row
+        OUTPUT_VARIABLE row
+        RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "parallel_marking_${count} failed: ${result}")
+    endif()
+    string(APPEND table "${row}")
+endforeach()
+file(WRITE ${BINARY_DIR}/parallel_marking.md "${table}")
+message("${table}")
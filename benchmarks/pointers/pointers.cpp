@@ -0,0 +1,233 @@
+#include "sgcl/sgcl.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+using namespace sgcl;
+
+struct Node {
+    int64_t value = 0;
+};
+
+struct Sgcl_node {
+    tracked_ptr<Sgcl_node> next;
+    int64_t value = 0;
+};
+
+struct Dense_node {
+    tracked_ptr<Dense_node> next;
+    tracked_ptr<Dense_node> edge1;
+    tracked_ptr<Dense_node> edge2;
+    tracked_ptr<Dense_node> edge3;
+    tracked_ptr<Dense_node> edge4;
+};
+
+struct Shared_node {
+    std::shared_ptr<Shared_node> next;
+    int64_t value = 0;
+};
+
+// the body runs the given number of iterations, the count grows until the minimum time passes
+template<class F>
+static void bench(const char* name, unsigned threads, F&& body) {
+    using clock = std::chrono::steady_clock;
+    static constexpr double MinTime = 0.2;
+    static constexpr int64_t MaxIterations = int64_t(1) << 30;
+    int64_t iterations = 1;
+    for (;;) {
+        auto t = clock::now();
+        std::vector<std::thread> workers;
+        for (unsigned i = 1; i < threads; ++i) {
+            workers.emplace_back([&]{ body(iterations); });
+        }
+        body(iterations);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        double time = std::chrono::duration<double>(clock::now() - t).count();
+        if (time >= MinTime || iterations == MaxIterations) {
+            std::printf("%-40s %10.2f ns %12lld\n", name, time * 1e9 / iterations, (long long)iterations);
+            return;
+        }
+        auto next = std::max(iterations * 2, (int64_t)(iterations * std::min(MinTime * 1.4 / std::max(time, 1e-9), 1e3)));
+        iterations = std::min(next, MaxIterations);
+    }
+}
+
+// keeps the compiler from removing the work on the value
+template<class T>
+static void do_not_optimize(T& value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "r"(&value) : "memory");
+#else
+    static std::atomic<void*> sink;
+    sink.store((void*)&value, std::memory_order_relaxed);
+#endif
+}
+
+static void allocation(unsigned threads) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "make_tracked/threads:%u", threads);
+    bench(name, threads, [](int64_t n) {
+        for (int64_t i = 0; i < n; ++i) {
+            root_ptr<Node> p = make_tracked<Node>();
+            do_not_optimize(p);
+        }
+    });
+    std::snprintf(name, sizeof(name), "make_shared/threads:%u", threads);
+    bench(name, threads, [](int64_t n) {
+        for (int64_t i = 0; i < n; ++i) {
+            auto p = std::make_shared<Node>();
+            do_not_optimize(p);
+        }
+    });
+}
+
+static void copy_and_move() {
+    root_ptr<Node> root = make_tracked<Node>();
+    bench("root_ptr copy", 1, [&](int64_t n) {
+        for (int64_t i = 0; i < n; ++i) {
+            root_ptr<Node> p = root;
+            do_not_optimize(p);
+        }
+    });
+    bench("root_ptr move", 1, [&](int64_t n) {
+        root_ptr<Node> p = root;
+        for (int64_t i = 0; i < n; ++i) {
+            root_ptr<Node> q = std::move(p);
+            p = std::move(q);
+            do_not_optimize(p);
+        }
+    });
+    auto shared = std::make_shared<Node>();
+    bench("shared_ptr copy", 1, [&](int64_t n) {
+        for (int64_t i = 0; i < n; ++i) {
+            std::shared_ptr<Node> p = shared;
+            do_not_optimize(p);
+        }
+    });
+    bench("shared_ptr move", 1, [&](int64_t n) {
+        std::shared_ptr<Node> p = shared;
+        for (int64_t i = 0; i < n; ++i) {
+            std::shared_ptr<Node> q = std::move(p);
+            p = std::move(q);
+            do_not_optimize(p);
+        }
+    });
+}
+
+// the stores alternate between two objects, so every store changes the pointer
+static void member_store() {
+    root_ptr<Sgcl_node> sgcl_node = make_tracked<Sgcl_node>();
+    root_ptr<Sgcl_node> sgcl_targets[2] = {make_tracked<Sgcl_node>(), make_tracked<Sgcl_node>()};
+    bench("tracked_ptr store", 1, [&](int64_t n) {
+        for (int64_t i = 0; i < n; ++i) {
+            sgcl_node->next = sgcl_targets[i & 1];
+        }
+    });
+    auto shared_node = std::make_shared<Shared_node>();
+    std::shared_ptr<Shared_node> shared_targets[2] = {std::make_shared<Shared_node>(), std::make_shared<Shared_node>()};
+    bench("shared_ptr member store", 1, [&](int64_t n) {
+        for (int64_t i = 0; i < n; ++i) {
+            shared_node->next = shared_targets[i & 1];
+        }
+    });
+}
+
+// every thread installs its own object in a CAS loop, the expected value of a tracked pointer
+// has to be a tracked_ptr, so it is kept in the object
+static void cas_loop(unsigned threads) {
+    char name[64];
+    atomic<root_ptr<Sgcl_node>> sgcl_ptr = make_tracked<Sgcl_node>();
+    std::snprintf(name, sizeof(name), "atomic<root_ptr> CAS/threads:%u", threads);
+    bench(name, threads, [&](int64_t n) {
+        root_ptr<Sgcl_node> node = make_tracked<Sgcl_node>();
+        auto& expected = node->next;
+        expected = sgcl_ptr.load(std::memory_order_relaxed);
+        for (int64_t i = 0; i < n; ++i) {
+            while (!sgcl_ptr.compare_exchange_weak(expected, node));
+            expected = node;
+        }
+        expected = nullptr;
+    });
+    auto shared_ptr = std::make_shared<Shared_node>();
+    std::snprintf(name, sizeof(name), "atomic shared_ptr CAS/threads:%u", threads);
+    bench(name, threads, [&](int64_t n) {
+        auto node = std::make_shared<Shared_node>();
+        auto expected = std::atomic_load_explicit(&shared_ptr, std::memory_order_relaxed);
+        for (int64_t i = 0; i < n; ++i) {
+            while (!std::atomic_compare_exchange_weak(&shared_ptr, &expected, node));
+            expected = node;
+        }
+    });
+}
+
+// a list of nodes with the given number of extra pointers per node to earlier nodes
+static void cycle_time(int64_t count, int density) {
+    root_ptr<Dense_node> head;
+    std::vector<unsafe_ptr<Dense_node>> nodes;
+    nodes.reserve(count);
+    for (int64_t i = 0; i < count; ++i) {
+        root_ptr<Dense_node> node = make_tracked<Dense_node>();
+        node->next = head;
+        tracked_ptr<Dense_node>* edges[] = {&node->edge1, &node->edge2, &node->edge3, &node->edge4};
+        for (int d = 0; d < density && i; ++d) {
+            *edges[d] = nodes[(i * 7919 + d * 104729) % i];
+        }
+        nodes.emplace_back(node);
+        head = node;
+    }
+    collector::force_collect(true);
+    static constexpr int Count = 5;
+    auto t = std::chrono::steady_clock::now();
+    for (int i = 0; i < Count; ++i) {
+        collector::force_collect(true);
+    }
+    double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t).count() / Count;
+    char name[64];
+    std::snprintf(name, sizeof(name), "gc cycle/objects:%lld/density:%d", (long long)count, density);
+    std::printf("%-40s %10.2f ms\n", name, time);
+}
+
+static void peak_rss() {
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    auto kb = usage.ru_maxrss / 1024;
+#else
+    auto kb = usage.ru_maxrss;
+#endif
+    std::printf("%-40s %10lld KB\n", "peak rss", (long long)kb);
+#endif
+}
+
+int main() {
+    auto threads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::printf("%-40s %13s %12s\n", "benchmark", "time", "iterations");
+    allocation(1);
+    if (threads > 1) {
+        allocation(threads);
+    }
+    copy_and_move();
+    member_store();
+    cas_loop(1);
+    if (threads > 1) {
+        cas_loop(threads);
+    }
+    for (int64_t count : {100000, 1000000}) {
+        for (int density : {0, 1, 4}) {
+            cycle_time(count, density);
+        }
+    }
+    peak_rss();
+}
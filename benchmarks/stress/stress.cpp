@@ -0,0 +1,466 @@
+#include "sgcl/sgcl.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+using namespace sgcl;
+
+// the debug shadow heap, every node owns a slot and its generation is odd while the node is alive,
+// nodes allocated when all slots are used are not tracked
+class Shadow_heap {
+public:
+    static constexpr uint32_t Capacity = 1 << 22;
+    static constexpr uint32_t Untracked = UINT32_MAX;
+
+    void enable() {
+        _generations.reset(new std::atomic<uint32_t>[Capacity]());
+    }
+
+    bool enabled() const noexcept {
+        return _generations != nullptr;
+    }
+
+    void acquire(uint32_t& slot, uint32_t& generation) {
+        slot = Untracked;
+        if (!enabled()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_free_slots.empty()) {
+            slot = _free_slots.back();
+            _free_slots.pop_back();
+        } else if (_next_slot < Capacity) {
+            slot = _next_slot++;
+        } else {
+            return;
+        }
+        generation = _generations[slot].load(std::memory_order_relaxed) + 1;
+        _generations[slot].store(generation, std::memory_order_release);
+    }
+
+    bool release(uint32_t slot, uint32_t generation) {
+        if (slot == Untracked) {
+            return true;
+        }
+        bool alive = _generations[slot].load(std::memory_order_relaxed) == generation;
+        _generations[slot].store(generation + 1, std::memory_order_release);
+        std::lock_guard<std::mutex> lock(_mutex);
+        _free_slots.push_back(slot);
+        return alive;
+    }
+
+    bool is_alive(uint32_t slot, uint32_t generation) const noexcept {
+        return slot == Untracked || _generations[slot].load(std::memory_order_acquire) == generation;
+    }
+
+private:
+    std::unique_ptr<std::atomic<uint32_t>[]> _generations;
+    std::mutex _mutex;
+    std::vector<uint32_t> _free_slots;
+    uint32_t _next_slot = 0;
+};
+
+static Shadow_heap shadow_heap;
+static std::atomic<int64_t> errors = {0};
+
+static void report(const char* what) {
+    if (errors.fetch_add(1, std::memory_order_relaxed) < 10) {
+        std::fprintf(stderr, "error: %s\n", what);
+    }
+}
+
+static uint64_t checksum(uint64_t value) noexcept {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdull;
+    return value ^ (value >> 33);
+}
+
+// the edges belong to the shared graph, next links the private list of the thread that made the node
+struct Node {
+    static constexpr uint32_t Alive = 0xa11fe;
+    static constexpr uint32_t Dead = 0xdead;
+    static constexpr int Edges = 3;
+
+    explicit Node(uint64_t v)
+        : value(v)
+        , check(checksum(v)) {
+        shadow_heap.acquire(slot, generation);
+    }
+
+    ~Node() {
+        if (magic.exchange(Dead, std::memory_order_relaxed) != Alive || !shadow_heap.release(slot, generation)) {
+            report("a node was destroyed twice");
+        }
+    }
+
+    std::atomic<uint32_t> magic = {Alive};
+    uint32_t slot = Shadow_heap::Untracked;
+    uint32_t generation = 0;
+    const uint64_t value;
+    const uint64_t check;
+    atomic<tracked_ptr<Node>> edges[Edges];
+    tracked_ptr<Node> next;
+};
+
+// a node reached by a mutator has to be alive
+static void validate(const Node* node) {
+    if (node->magic.load(std::memory_order_relaxed) != Node::Alive || node->check != checksum(node->value)
+        || !shadow_heap.is_alive(node->slot, node->generation)) {
+        report("a reachable node was destroyed");
+    }
+}
+
+struct Random {
+    uint64_t operator()() noexcept {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+    uint64_t state;
+};
+
+static constexpr int Roots = 64;
+static constexpr int PrivateLength = 256;
+static atomic<root_ptr<Node>> roots[Roots];
+
+// the operations mix the unique_ptr path, plain and atomic stores of tracked_ptr,
+// and loads, stores, exchanges and CAS of atomic<root_ptr>
+static int64_t mutate(unsigned id, const std::atomic<bool>& stop) {
+    Random random = {0x9e3779b97f4a7c15ull * (id + 1)};
+    root_ptr<Node> cursor;
+    root_ptr<Node> scratch = make_tracked<Node>(0);
+    root_ptr<Node> list;
+    int length = 0;
+    int64_t ops = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        auto& root = roots[random() % Roots];
+        switch (random() % 8) {
+        case 0: {
+            unique_ptr<Node> node = make_tracked<Node>(random());
+            for (auto& edge : node->edges) {
+                cursor = roots[random() % Roots].load();
+                edge.store(cursor);
+            }
+            root.store(std::move(node));
+            break;
+        }
+        case 1:
+        case 2:
+            cursor = root.load();
+            for (int depth = 0; depth < 16 && cursor; ++depth) {
+                validate(cursor.get());
+                cursor = cursor->edges[random() % Node::Edges].load();
+            }
+            break;
+        case 3:
+            cursor = root.load();
+            for (int depth = random() % 4; depth > 0 && cursor; --depth) {
+                cursor = cursor->edges[random() % Node::Edges].load();
+            }
+            if (cursor) {
+                validate(cursor.get());
+                auto& edge = cursor->edges[random() % Node::Edges];
+                switch (random() % 3) {
+                case 0: edge.store(root_ptr<Node>()); break;
+                case 1: edge.store(make_tracked<Node>(random())); break;
+                default: {
+                    root_ptr<Node> target = roots[random() % Roots].load();
+                    edge.store(target);
+                }
+                }
+            }
+            break;
+        case 4: {
+            // the expected value of a CAS has to be a tracked_ptr, so it is kept in the object
+            auto& expected = scratch->next;
+            expected = root.load();
+            root_ptr<Node> desired = make_tracked<Node>(random());
+            if (expected) {
+                desired->edges[0].store(expected);
+            }
+            while (!root.compare_exchange_weak(expected, desired)) {
+                if (expected) {
+                    validate(expected.get());
+                }
+                desired->edges[0].store(expected);
+            }
+            expected = nullptr;
+            break;
+        }
+        case 5: {
+            auto& swapped = scratch->next;
+            swapped = make_tracked<Node>(random());
+            root.exchange(swapped);
+            if (swapped) {
+                validate(swapped.get());
+                roots[random() % Roots].store(swapped);
+            }
+            swapped = nullptr;
+            break;
+        }
+        case 6: {
+            // the private list is trimmed at a random node, the cut tail becomes garbage
+            root_ptr<Node> node = make_tracked<Node>(random());
+            node->next = list;
+            cursor = root.load();
+            node->edges[0].store(cursor);
+            list = node;
+            if (++length > PrivateLength) {
+                cursor = list;
+                for (int i = random() % PrivateLength; i > 0; --i) {
+                    validate(cursor.get());
+                    cursor = cursor->next;
+                }
+                validate(cursor.get());
+                cursor->next = nullptr;
+                length = 0;
+                for (cursor = list; cursor; cursor = cursor->next) {
+                    ++length;
+                }
+            }
+            break;
+        }
+        default: {
+            // a unique_ptr keeps a new subgraph while other nodes are allocated
+            unique_ptr<Node> node = make_tracked<Node>(random());
+            for (auto& edge : node->edges) {
+                edge.store(make_tracked<Node>(random()));
+            }
+            cursor = root.load();
+            if (cursor) {
+                validate(cursor.get());
+                node->edges[0].load()->edges[0].store(cursor);
+            }
+            validate(node.get());
+            for (auto& edge : node->edges) {
+                validate(edge.load().get());
+            }
+            root.store(std::move(node));
+        }
+        }
+        ++ops;
+    }
+    return ops;
+}
+
+static int64_t rss_kb() {
+#if defined(__linux__)
+    if (FILE* file = std::fopen("/proc/self/statm", "r")) {
+        long pages = 0;
+        long resident = 0;
+        int read = std::fscanf(file, "%ld %ld", &pages, &resident);
+        std::fclose(file);
+        if (read == 2) {
+            return resident * (sysconf(_SC_PAGESIZE) / 1024);
+        }
+    }
+#endif
+    return 0;
+}
+
+static int64_t peak_rss_kb() {
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+// after the mutators stop, every node reachable from the roots has to be alive,
+// returns the number of reachable nodes
+static int64_t validate_roots() {
+    std::unordered_set<const Node*> visited;
+    std::vector<root_ptr<Node>> stack;
+    for (auto& root : roots) {
+        if (auto node = root.load()) {
+            stack.push_back(node);
+        }
+    }
+    while (!stack.empty()) {
+        auto node = stack.back();
+        stack.pop_back();
+        if (!visited.insert(node.get()).second) {
+            continue;
+        }
+        validate(node.get());
+        for (auto& edge : node->edges) {
+            if (auto next = edge.load()) {
+                stack.push_back(next);
+            }
+        }
+    }
+    return (int64_t)visited.size();
+}
+
+// erasing while iterating has to visit every entry once, also when a probe sequence wraps
+// around the end of the table, at 7/8 load most of the tables have such sequences
+static void check_unordered_map() {
+    for (int round = 0; round < 1000; ++round) {
+        auto map = make_tracked<unordered_map<int, int>>();
+        int count = 7 * 64 / 8 - 1;
+        for (int i = 0; i < count; ++i) {
+            map->insert(round * count + i, 0);
+        }
+        std::vector<int> visits(count);
+        for (auto i = map->begin(); i != map->end();) {
+            auto key = i->first - round * count;
+            ++visits[key];
+            i = key % 2 ? map->erase(i) : std::next(i);
+        }
+        for (int key = 0; key < count; ++key) {
+            if (visits[key] != 1 || map->contains(round * count + key) != !(key % 2)) {
+                report("unordered_map::erase revisited or skipped an entry");
+                return;
+            }
+        }
+    }
+}
+
+struct Result {
+    unsigned threads;
+    double ops_per_second;
+    int64_t cycles;
+    int64_t removed_objects;
+    int64_t rss_kb;
+    int64_t peak_rss_kb;
+    int64_t reachable;
+    int64_t garbage;
+    int64_t errors;
+};
+
+// the main thread requests a collection every few milliseconds, so cycles overlap the mutations
+static Result run(unsigned threads, double seconds) {
+    using clock = std::chrono::steady_clock;
+    for (auto& root : roots) {
+        root.store(make_tracked<Node>(0));
+    }
+    auto errors_before = errors.load();
+    auto stats = collector::stats();
+    std::atomic<bool> stop = {false};
+    std::atomic<int64_t> ops = {0};
+    std::vector<std::thread> mutators;
+    auto t = clock::now();
+    for (unsigned i = 0; i < threads; ++i) {
+        mutators.emplace_back([&, i]{ ops += mutate(i, stop); });
+    }
+    while (std::chrono::duration<double>(clock::now() - t).count() < seconds) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        collector::force_collect();
+    }
+    stop = true;
+    for (auto& mutator : mutators) {
+        mutator.join();
+    }
+    double time = std::chrono::duration<double>(clock::now() - t).count();
+    Result result = {};
+    result.threads = threads;
+    result.ops_per_second = ops / time;
+    result.rss_kb = rss_kb();
+    // an object stored by an atomic pointer is kept for DeletionDelayMsec
+    int64_t live = 0;
+    for (int i = 0; i < 20; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(i ? 50 : 0));
+        collector::force_collect(true);
+        result.reachable = validate_roots();
+        live = collector::live_objects_number();
+        if (live <= result.reachable) {
+            break;
+        }
+    }
+    result.garbage = std::max(live - result.reachable, int64_t(0));
+    if (result.garbage) {
+        report("unreachable nodes were not destroyed");
+    }
+    auto last = collector::stats();
+    result.cycles = last.cycles - stats.cycles;
+    result.removed_objects = last.removed_objects - stats.removed_objects;
+    result.peak_rss_kb = peak_rss_kb();
+    result.errors = errors.load() - errors_before;
+    return result;
+}
+
+int main(int argc, char** argv) {
+    unsigned max_threads = std::max(std::thread::hardware_concurrency(), 2u);
+    double seconds = 2;
+    const char* csv = nullptr;
+#ifndef NDEBUG
+    bool check = true;
+#else
+    bool check = false;
+#endif
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--threads") && i + 1 < argc) {
+            max_threads = std::max(std::atoi(argv[++i]), 1);
+        } else if (!std::strcmp(argv[i], "--seconds") && i + 1 < argc) {
+            seconds = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--csv") && i + 1 < argc) {
+            csv = argv[++i];
+        } else if (!std::strcmp(argv[i], "--check")) {
+            check = true;
+        } else {
+            std::fprintf(stderr, "usage: %s [--threads n] [--seconds s] [--csv file] [--check]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (check) {
+        shadow_heap.enable();
+        check_unordered_map();
+    }
+    std::vector<unsigned> counts;
+    for (unsigned threads = 1; threads < max_threads; threads *= 2) {
+        counts.push_back(threads);
+    }
+    counts.push_back(max_threads);
+
+    std::printf("%8s %14s %8s %12s %10s %10s %10s %8s %7s\n",
+        "threads", "ops/s", "cycles", "removed", "rss KB", "peak KB", "reachable", "garbage", "errors");
+    std::vector<Result> results;
+    for (auto threads : counts) {
+        auto r = run(threads, seconds);
+        std::printf("%8u %14.0f %8lld %12lld %10lld %10lld %10lld %8lld %7lld\n",
+            r.threads, r.ops_per_second, (long long)r.cycles, (long long)r.removed_objects, (long long)r.rss_kb,
+            (long long)r.peak_rss_kb, (long long)r.reachable, (long long)r.garbage, (long long)r.errors);
+        std::fflush(stdout);
+        results.push_back(r);
+    }
+    if (csv) {
+        if (FILE* file = std::fopen(csv, "w")) {
+            std::fprintf(file, "threads,ops_per_second,cycles,removed_objects,rss_kb,peak_rss_kb,reachable,garbage,errors,checked\n");
+            for (auto& r : results) {
+                std::fprintf(file, "%u,%.0f,%lld,%lld,%lld,%lld,%lld,%lld,%lld,%d\n",
+                    r.threads, r.ops_per_second, (long long)r.cycles, (long long)r.removed_objects, (long long)r.rss_kb,
+                    (long long)r.peak_rss_kb, (long long)r.reachable, (long long)r.garbage, (long long)r.errors, (int)check);
+            }
+            std::fclose(file);
+        } else {
+            std::fprintf(stderr, "error: cannot write %s\n", csv);
+            return 2;
+        }
+    }
+    if (errors) {
+        std::fprintf(stderr, "%lld validation errors\n", (long long)errors.load());
+        return 1;
+    }
+}
@@ -0,0 +1,30 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "priv/thread.h"
+
+namespace sgcl {
+    // small objects made by the thread within the scope are allocated on pages of the scope,
+    // after the scope ends the collector frees each page without reachable objects at once;
+    // the pages with reachable objects are swept and reused normally
+    class arena_scope {
+    public:
+        arena_scope() noexcept {
+            Priv::Current_thread().enter_arena(_arena);
+        }
+
+        arena_scope(const arena_scope&) = delete;
+        arena_scope& operator=(const arena_scope&) = delete;
+
+        ~arena_scope() noexcept {
+            Priv::Current_thread().leave_arena(_arena);
+        }
+
+    private:
+        Priv::Thread::Arena _arena;
+    };
+}
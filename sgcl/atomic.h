@@ -7,6 +7,7 @@
 
 #include "tracked_ptr.h"
 #include "root_ptr.h"
+#include "unsafe_ptr.h"
 
 namespace sgcl {
     template<class T>
@@ -54,20 +55,31 @@ namespace sgcl {
             return t;
         }
 
+        // no root is allocated, the loaded object is kept by its state for a few cycles and at least
+        // DeletionDelayMsec; the pointer is meant for short accesses, a root_ptr keeps the object longer
+        unsafe_ptr<Type> load_unsafe(const std::memory_order m = std::memory_order_seq_cst) const noexcept {
+            return unsafe_ptr<Type>((typename unsafe_ptr<Type>::element_type*)_ptr().load_atomic(m));
+        }
+
         void store(const tracked_ptr<Type>& p, const std::memory_order m = std::memory_order_seq_cst) noexcept {
             _ptr().update_atomic();
             _ptr().store(p.get(), m);
+            _remember();
         }
 
+        // the UniqueLock state of the stored object is replaced, it would keep the object forever
         void store(unique_ptr<Type>&& p, const std::memory_order m = std::memory_order_seq_cst) noexcept {
             _ptr().update_atomic();
-            _ptr().store(p.release(), m);
+            _ptr().force_store(p.release(), m);
+            _remember();
         }
 
         void exchange(tracked_ptr<Type>& p, const std::memory_order m = std::memory_order_seq_cst) {
             _ptr().update_atomic();
             auto l = _ptr().exchange(p.get(), m);
+            _remember();
             p._ptr().store(l);
+            p._ptr().remember();
         }
 
         bool compare_exchange_strong(tracked_ptr<Type>& e, const tracked_ptr<Type>& n, const std::memory_order m = std::memory_order_seq_cst) noexcept {
@@ -75,8 +87,10 @@ namespace sgcl {
             void* l = e.get();
             if (!_ptr().compare_exchange_strong(l, n.get(), m)) {
                 e._ptr().store(l);
+                e._ptr().remember();
                 return false;
             }
+            _remember();
             return true;
         }
 
@@ -85,8 +99,10 @@ namespace sgcl {
             void* l = e.get();
             if (!_ptr().compare_exchange_strong(l, n.get(), s, f)) {
                 e._ptr().store(l);
+                e._ptr().remember();
                 return false;
             }
+            _remember();
             return true;
         }
 
@@ -95,8 +111,10 @@ namespace sgcl {
             void* l = e.get();
             if (!_ptr().compare_exchange_weak(l, n.get(), m)) {
                 e._ptr().store(l);
+                e._ptr().remember();
                 return false;
             }
+            _remember();
             return true;
         }
 
@@ -105,8 +123,10 @@ namespace sgcl {
             void* l = e.get();
             if (!_ptr().compare_exchange_weak(l, n.get(), s, f)) {
                 e._ptr().store(l);
+                e._ptr().remember();
                 return false;
             }
+            _remember();
             return true;
         }
 
@@ -123,6 +143,12 @@ namespace sgcl {
             return _val._ptr();
         }
 
+        void _remember() noexcept {
+            if constexpr(std::is_base_of_v<Priv::Tracked, value_type>) {
+                _ptr().remember();
+            }
+        }
+
         value_type _val;
     };
 }
@@ -6,6 +6,13 @@
 #pragma once
 
 #include "priv/collector.h"
+#include "collector_policy.h"
+#include "collector_stats.h"
+#include "collector_tracer.h"
+#include "heap_snapshot.h"
+#include "latency_histogram.h"
+#include "priv/heap_snapshot_writer.h"
+#include "shutdown_mode.h"
 #include "unique_ptr.h"
 
 namespace sgcl {
@@ -14,18 +21,106 @@ namespace sgcl {
             return Priv::Collector_instance().live_objects_number();
         }
 
+        inline static collector_stats stats() noexcept {
+            return Priv::Collector_instance().stats();
+        }
+
+        inline static void set_policy(const collector_policy& policy) {
+            Priv::Collector_instance().set_policy(policy);
+        }
+
+        inline static collector_policy policy() {
+            return Priv::Collector_instance().policy();
+        }
+
+        // the destructors of unreachable objects of types with deferred_destruction metadata, or of all
+        // types, are passed to the executor in batches; the slots are reused after a batch is run, the
+        // executor has to run every batch (nullptr - destructors run on the GC thread or the sweeping threads)
+        inline static void set_destruction_executor(std::function<void(std::function<void()>)> executor, bool all_types = false) {
+            Priv::Collector_instance().set_destruction_executor(std::move(executor), all_types);
+        }
+
+        // called on the GC thread with the number of weak pointers cleared in a cycle, before the sweep
+        // of their objects; the callback must not wait for a collection (nullptr - no callback), see weak_ptr
+        inline static void set_weak_callback(std::function<void(size_t)> callback) {
+            Priv::Collector_instance().set_weak_callback(std::move(callback));
+        }
+
+#if SGCL_TRACING
+        // the tracer is used from the next cycle (nullptr - no tracing), see collector_tracer
+        inline static void set_tracer(std::shared_ptr<collector_tracer> tracer) {
+            Priv::Collector_instance().set_tracer(std::move(tracer));
+        }
+#endif
+
+#if SGCL_PROFILER
+        // one allocation is sampled every rate bytes (0 - sampling is stopped)
+        inline static void set_profiler_rate(size_t rate) noexcept {
+            Priv::Profiler::set_rate(rate);
+        }
+
+        inline static size_t profiler_rate() noexcept {
+            return Priv::Profiler::rate();
+        }
+
+        // writes the sampled allocations in the pprof format
+        inline static void write_profile(std::ostream& out) {
+            Priv::Profiler::write(out);
+        }
+#endif
+
+#if SGCL_LATENCY_HISTOGRAMS
+        inline static latency_histogram latency(latency_event event) noexcept {
+            return Priv::Latency_histogram::of(event).snapshot();
+        }
+
+        inline static void reset_latency() noexcept {
+            for (unsigned i = 0; i < Priv::Latency_histogram::EventCount; ++i) {
+                Priv::Latency_histogram::of((latency_event)i).reset();
+            }
+        }
+#endif
+
+        // moves the objects of movable types (see metadata::movable) out of the pages with at most
+        // the given fraction of places in use, so the emptied pages are released; it is done at the end
+        // of a full cycle, the call waits for it and no other thread may use tracked objects meanwhile;
+        // returns the number of moved objects
+        inline static size_t compact(double occupancy = 0.25) {
+            return Priv::Collector_instance().compact(occupancy);
+        }
+
         inline static unique_ptr<tracked_ptr<void>[]> live_objects() {
             unique_ptr<tracked_ptr<void>[]> array;
             Priv::Collector_instance().live_objects((Priv::Unique_ptr<Priv::Tracked_ptr[]>&)array);
             return array;
         }
 
+        // visits the reachable objects in a single cycle, nothing is allocated on the managed heap
+        inline static void visit_heap(heap_visitor& visitor) noexcept {
+            Priv::Collector_instance().visit_heap(visitor);
+        }
+
+        // writes the reachable objects in the binary format described in priv/heap_snapshot_writer.h
+        inline static void write_heap_snapshot(std::ostream& out) {
+            Priv::Heap_snapshot_writer writer(out);
+            Priv::Collector_instance().visit_heap(writer);
+        }
+
+#if SGCL_COOPERATIVE
+        // runs the collector on the calling thread for about the budget, a step of a cycle is at least
+        // a page; returns true if a cycle was completed
+        inline static bool step(std::chrono::microseconds budget) {
+            return Priv::Collector_instance().step(std::chrono::duration<double, std::milli>(budget).count());
+        }
+#endif
+
         inline static void force_collect(bool wait = false) noexcept {
             Priv::Collector_instance().force_collect(wait);
         }
 
-        inline static void terminate() noexcept {
-            Priv::Collector::terminate();
+        // stops the collector, the memory of objects left is not freed; see shutdown_mode
+        inline static void terminate(shutdown_mode mode = shutdown_mode::finalize) noexcept {
+            Priv::Collector::terminate(mode);
         }
     };
 }
@@ -0,0 +1,46 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "configuration.h"
+
+#include <cstdint>
+#include <memory>
+
+namespace sgcl {
+    // the state seen by the GC thread while it waits for the next cycle, sizes are in bytes
+    struct collector_pacing {
+        int64_t live_objects = {0};
+        int64_t live_bytes = {0};
+        int64_t allocated_objects = {0};
+        int64_t allocated_bytes = {0};
+        int64_t removed_objects = {0};
+        int64_t removed_bytes = {0};
+        int64_t heap_bytes = {0};
+        double sleep_time = {0};
+    };
+
+    // called on the GC thread every poll interval, returns true to start the next cycle
+    struct collector_pacer {
+        virtual ~collector_pacer() = default;
+        virtual bool collect(const collector_pacing&) = 0;
+    };
+
+    struct collector_policy {
+        // the percentage amount of allocations that will wake up the GC thread
+        double trigger_percentage = {SGCL_TRIGER_PERCENTAGE};
+        // the maximum sleep time of the GC thread in seconds
+        double max_sleep_time = {SGCL_MAX_SLEEP_TIME_SEC};
+        // the interval of checking the trigger conditions in milliseconds
+        double poll_interval = {1};
+        // a cycle starts when live and allocated bytes reach the target (0 - no target)
+        int64_t heap_size_target = {0};
+        // the trigger percentage drops to zero as heap pages approach the limit (0 - no limit)
+        int64_t soft_memory_limit = {0};
+        // replaces the trigger conditions above, the sleep time limit still applies
+        std::shared_ptr<collector_pacer> pacer;
+    };
+}
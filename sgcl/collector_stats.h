@@ -0,0 +1,37 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include <cstdint>
+
+namespace sgcl {
+    // times are in milliseconds, the last_* values describe the last finished cycle
+    struct collector_stats {
+        int64_t cycles = {0};
+        int64_t allocated_objects = {0};
+        int64_t allocated_bytes = {0};
+        int64_t removed_objects = {0};
+        int64_t removed_bytes = {0};
+        double total_time = {0};
+
+        int64_t last_allocated_objects = {0};
+        int64_t last_allocated_bytes = {0};
+        int64_t last_removed_objects = {0};
+        int64_t last_removed_bytes = {0};
+        double last_time = {0};
+        double last_states_time = {0};
+        double last_register_time = {0};
+        double last_roots_time = {0};
+        double last_mark_time = {0};
+        double last_sweep_time = {0};
+        double last_release_time = {0};
+
+        int64_t live_objects = {0};
+        int64_t live_bytes = {0};
+        int64_t heap_bytes = {0};
+        int64_t threads = {0};
+    };
+}
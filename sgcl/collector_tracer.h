@@ -0,0 +1,47 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "configuration.h"
+
+#include <cstdint>
+
+namespace sgcl {
+    // the phases of a cycle in their order, see collector::set_tracer()
+    enum class collector_phase {
+        check_threads,
+        update_states,
+        register_objects,
+        mark_stack_roots,
+        mark_heap_roots,
+        mark,
+        sweep,
+        release_pages
+    };
+
+    // called on the GC thread with SGCL_TRACING, the counts of a phase are objects and pages
+    // it visited: threads, aged and registered dirty pages, roots, marked objects, destroyed
+    // objects and swept pages, kept pages; a phase split into steps is reported per step
+    struct collector_tracer {
+        virtual ~collector_tracer() = default;
+        virtual void begin(collector_phase) noexcept {}
+        virtual void end(collector_phase, int64_t /*objects*/, int64_t /*pages*/) noexcept {}
+
+        static const char* name(collector_phase phase) noexcept {
+            switch (phase) {
+                case collector_phase::check_threads: return "check_threads";
+                case collector_phase::update_states: return "update_states";
+                case collector_phase::register_objects: return "register_objects";
+                case collector_phase::mark_stack_roots: return "mark_stack_roots";
+                case collector_phase::mark_heap_roots: return "mark_heap_roots";
+                case collector_phase::mark: return "mark";
+                case collector_phase::sweep: return "sweep";
+                case collector_phase::release_pages: return "release_pages";
+            }
+            return "unknown";
+        }
+    };
+}
@@ -7,10 +7,108 @@
 
 //#define SGCL_DEBUG
 
-// the maximum sleep time of the GC thread in seconds
+// the default maximum sleep time of the GC thread in seconds, see collector::set_policy()
+#ifndef SGCL_MAX_SLEEP_TIME_SEC
 #define SGCL_MAX_SLEEP_TIME_SEC 30
-// the percentage amount of allocations that will wake up the GC thread
+#endif
+// the default percentage amount of allocations that will wake up the GC thread
+#ifndef SGCL_TRIGER_PERCENTAGE
 #define SGCL_TRIGER_PERCENTAGE 25
+#endif
+// the number of additional threads used for marking (0 - marking on the GC thread only)
+#ifndef SGCL_MARKING_THREADS
+#define SGCL_MARKING_THREADS 0
+#endif
+// mark objects through a stack of pointers with prefetching instead of rescanning the flags of pages,
+// e.g. -DSGCL_MARK_STACK=1 for deep pointer-chasing graphs (0 - pages only); the marking threads use pages
+#ifndef SGCL_MARK_STACK
+#define SGCL_MARK_STACK 0
+#endif
+// the number of threads running destructors of unreachable objects (0 - destructors run on the GC thread)
+#ifndef SGCL_SWEEPING_THREADS
+#define SGCL_SWEEPING_THREADS 0
+#endif
+// use SSE2/AVX2/NEON kernels to scan object states, e.g. -DSGCL_SIMD=1 (0 - scalar code)
+#ifndef SGCL_SIMD
+#define SGCL_SIMD 0
+#endif
+// collect young objects in minor cycles that do not trace old ones (0 - every cycle traces the whole heap)
+#ifndef SGCL_GENERATIONAL
+#define SGCL_GENERATIONAL 0
+#endif
+// the number of minor cycles between full cycles in the generational mode
+#ifndef SGCL_MINOR_CYCLES
+#define SGCL_MINOR_CYCLES 8
+#endif
+// no GC thread, the collector runs in time-bounded steps, see collector::step()
+#ifndef SGCL_COOPERATIVE
+#define SGCL_COOPERATIVE 0
+#endif
+// the number of states of ended threads kept for threads started later, with their allocators and
+// the partly used pages, e.g. -DSGCL_THREAD_CACHE=16 for short-lived threads (0 - the state of a thread
+// is released when it ends)
+#ifndef SGCL_THREAD_CACHE
+#define SGCL_THREAD_CACHE 0
+#endif
+
+// the size of heap pages in bytes, a power of two
+#ifndef SGCL_PAGE_SIZE
+#define SGCL_PAGE_SIZE 4096
+#endif
+// small objects of different types with equal sizes share pages (0 - pages per type)
+#ifndef SGCL_SIZE_CLASSES
+#define SGCL_SIZE_CLASSES 0
+#endif
+// large objects of at least this size in bytes are mapped directly from the OS, POSIX only (0 - C++ heap only)
+#ifndef SGCL_LARGE_MMAP_THRESHOLD
+#define SGCL_LARGE_MMAP_THRESHOLD 0x100000
+#endif
+// the maximum size in bytes of freed large object memory kept for reuse
+#ifndef SGCL_LARGE_CACHE_SIZE
+#define SGCL_LARGE_CACHE_SIZE 0x4000000
+#endif
+// map pages in 2 MB regions directly from the OS, Linux only (0 - 64 KB blocks from the C++ heap)
+#ifndef SGCL_OS_BLOCKS
+#define SGCL_OS_BLOCKS 0
+#endif
+// back the OS regions with transparent huge pages
+#ifndef SGCL_HUGE_PAGES
+#define SGCL_HUGE_PAGES 0
+#endif
+// keep the unused places of small objects zeroed, they are cleared when objects are freed and new pages
+// in bulk, so allocations skip clearing; the sweep writes every freed place (0 - objects are cleared
+// when allocated)
+#ifndef SGCL_ZEROED_SLOTS
+#define SGCL_ZEROED_SLOTS 0
+#endif
+// the number of NUMA nodes with separate lists of free pages (1 - one list)
+#ifndef SGCL_NUMA_NODES
+#define SGCL_NUMA_NODES 1
+#endif
+// sample allocations by type and call stack, see collector::write_profile()
+#ifndef SGCL_PROFILER
+#define SGCL_PROFILER 0
+#endif
+// the default number of allocated bytes between samples
+#ifndef SGCL_PROFILER_RATE
+#define SGCL_PROFILER_RATE 0x80000
+#endif
+// the number of call stack frames recorded with a sample, POSIX only (0 - types only)
+#ifndef SGCL_PROFILER_STACK_DEPTH
+#define SGCL_PROFILER_STACK_DEPTH 0
+#endif
+// the number of cycles of the last survival count in profiles, the first ones are 1 and 2
+#ifndef SGCL_PROFILER_SURVIVAL_CYCLES
+#define SGCL_PROFILER_SURVIVAL_CYCLES 8
+#endif
+// report the phases of cycles to a tracer, see collector::set_tracer()
+#ifndef SGCL_TRACING
+#define SGCL_TRACING 0
+#endif
+// time allocation slow paths and forced collections in histograms, see collector::latency()
+#ifndef SGCL_LATENCY_HISTOGRAMS
+#define SGCL_LATENCY_HISTOGRAMS 0
+#endif
 
 #ifdef SGCL_DEBUG
 #define SGCL_LOG_PRINT_LEVEL 3
@@ -22,12 +120,20 @@
 namespace sgcl {
     struct metadata : metadata_base {
         virtual void to_string(void*) {}
+        // destructors of the type run on the executor, see collector::set_destruction_executor()
+        bool deferred_destruction = {false};
+        // destructors of the type run when the collector ends with shutdown_mode::opted
+        bool finalize_on_shutdown = {false};
+        // objects of the type can be moved by collector::compact(), the type has to be trivially
+        // relocatable and its objects must not be identified by their addresses
+        bool movable = {false};
     };
 
     namespace Priv {
         static constexpr ptrdiff_t MaxStackSize = 0x100000;
         static constexpr ptrdiff_t StackDetectionOffset = 1024;
-        static constexpr size_t MaxTypeNumber = 4096;
+        // tracked pointers are found by the first construction of a type in this part of its objects
+        static constexpr size_t MaxMappedObjectSize = 4096;
         static constexpr int DeletionDelayMsec = 100;
    }
 }
@@ -0,0 +1,40 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "priv/deep_clone.h"
+#include "root_ptr.h"
+#include "tracked_ptr.h"
+#include "unique_ptr.h"
+#include "unsafe_ptr.h"
+
+namespace sgcl {
+    // copies all objects reachable from the pointer, shared objects are copied once and cycles are kept,
+    // the graph should not be changed during the copy; the types must be copy constructible
+    template<class T>
+    unique_ptr<T> deep_clone(const root_ptr<T>& p) {
+        using element_type = typename root_ptr<T>::element_type;
+        return unique_ptr<T>((element_type*)Priv::Deep_clone::clone(p.get()), Priv::Tracked());
+    }
+
+    template<class T>
+    unique_ptr<T> deep_clone(const tracked_ptr<T>& p) {
+        using element_type = typename tracked_ptr<T>::element_type;
+        return unique_ptr<T>((element_type*)Priv::Deep_clone::clone(p.get()), Priv::Tracked());
+    }
+
+    template<class T>
+    unique_ptr<T> deep_clone(const unsafe_ptr<T>& p) {
+        using element_type = typename unsafe_ptr<T>::element_type;
+        return unique_ptr<T>((element_type*)Priv::Deep_clone::clone(p.get()), Priv::Tracked());
+    }
+
+    template<class T>
+    unique_ptr<T> deep_clone(const unique_ptr<T>& p) {
+        using element_type = typename unique_ptr<T>::element_type;
+        return unique_ptr<T>((element_type*)Priv::Deep_clone::clone(p.get()), Priv::Tracked());
+    }
+}
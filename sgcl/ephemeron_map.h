@@ -0,0 +1,70 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "priv/ephemeron_table.h"
+#include "root_ptr.h"
+#include "tracked_ptr.h"
+#include "types.h"
+
+namespace sgcl {
+    // a side table that maps tracked objects to tracked values; a key is not kept alive by the map,
+    // and a value is kept alive only while its key is reachable, so values may point back to their
+    // keys; the entries of unreachable keys are removed by the collector; the map is thread-safe and
+    // is not a managed object itself, e.g. a global or a member of an unmanaged structure
+    template<class K, class V>
+    class ephemeron_map {
+        static_assert(!std::is_array_v<K> && !std::is_array_v<V>, "ephemeron_map of arrays is not supported");
+
+    public:
+        using key_type = K;
+        using mapped_type = V;
+
+        ephemeron_map() = default;
+        ephemeron_map(const ephemeron_map&) = delete;
+        ephemeron_map& operator=(const ephemeron_map&) = delete;
+
+        size_t size() const noexcept {
+            return _table.size();
+        }
+
+        bool empty() const noexcept {
+            return !size();
+        }
+
+        // the value of the key, or nullptr if there is no entry
+        root_ptr<V> get(const tracked_ptr<K>& key) const {
+            root_ptr<V> value;
+            if (key) {
+                _table.get(key.get(), [&](void* p) {
+                    value = root_ptr<V>((V*)p);
+                });
+            }
+            return value;
+        }
+
+        bool contains(const tracked_ptr<K>& key) const {
+            return key && _table.get(key.get(), [](void*) {});
+        }
+
+        // an entry with a null value is kept, the key is not null
+        void set(const tracked_ptr<K>& key, const tracked_ptr<V>& value) {
+            assert(key != nullptr);
+            _table.set(key.get(), value.get());
+        }
+
+        bool erase(const tracked_ptr<K>& key) noexcept {
+            return key && _table.erase(key.get());
+        }
+
+        void clear() noexcept {
+            _table.clear();
+        }
+
+    private:
+        mutable Priv::Ephemeron_table _table;
+    };
+}
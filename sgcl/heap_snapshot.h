@@ -0,0 +1,28 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <typeinfo>
+
+namespace sgcl {
+    // an object reachable in the snapshot cycle, edges are addresses of the referenced objects
+    struct heap_object {
+        const void* address;
+        const std::type_info& type;
+        size_t size;
+        const void* const* edges;
+        size_t edge_count;
+    };
+
+    // called on the GC thread during marking, it must not use the managed heap
+    struct heap_visitor {
+        virtual ~heap_visitor() = default;
+        virtual void visit(const heap_object&) = 0;
+        // every non-null stack and heap root, before the objects
+        virtual void visit_root(const void*) {}
+    };
+}
@@ -0,0 +1,83 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace sgcl {
+    // the slow paths timed with SGCL_LATENCY_HISTOGRAMS, see collector::latency()
+    enum class latency_event {
+        // the pointer pool of an allocator is refilled, including new pages
+        pool_refill,
+        // a page is taken from the block allocator
+        new_page,
+        // a block of pages is allocated
+        new_block,
+        // a large object is allocated
+        large_alloc,
+        // force_collect(true) waits for the cycles
+        forced_collect_wait
+    };
+
+    // times in nanoseconds, the buckets are log-linear like in HDR histograms: each power
+    // of two range is split into 16 buckets, so a value is known with a 6% precision
+    struct latency_histogram {
+        static constexpr unsigned SubBucketBits = 4;
+        static constexpr unsigned SubBucketCount = 1 << SubBucketBits;
+        // values from 2^MaxExponent ns (about 18 minutes) are counted in the last bucket
+        static constexpr unsigned MaxExponent = 40;
+        static constexpr unsigned BucketCount = (MaxExponent - SubBucketBits + 1) * SubBucketCount;
+
+        static unsigned bucket_of(uint64_t ns) noexcept {
+            if (ns < SubBucketCount) {
+                return (unsigned)ns;
+            }
+            unsigned exponent = 63;
+            while (!(ns >> exponent)) {
+                --exponent;
+            }
+            if (exponent >= MaxExponent) {
+                return BucketCount - 1;
+            }
+            auto sub_bucket = (unsigned)(ns >> (exponent - SubBucketBits)) & (SubBucketCount - 1);
+            return (exponent - SubBucketBits + 1) * SubBucketCount + sub_bucket;
+        }
+
+        // the largest value counted in the bucket
+        static uint64_t bucket_max(unsigned bucket) noexcept {
+            if (bucket < SubBucketCount) {
+                return bucket;
+            }
+            auto exponent = bucket / SubBucketCount + SubBucketBits - 1;
+            auto sub_bucket = uint64_t(bucket % SubBucketCount + SubBucketCount);
+            return ((sub_bucket + 1) << (exponent - SubBucketBits)) - 1;
+        }
+
+        // the upper bound of the bucket of the percentile (0 - 100), the maximum is exact
+        uint64_t percentile(double p) const noexcept {
+            if (!count) {
+                return 0;
+            }
+            auto rank = (uint64_t)(p / 100 * count + 0.5);
+            rank = rank < 1 ? 1 : rank;
+            uint64_t total = 0;
+            for (unsigned i = 0; i < BucketCount; ++i) {
+                total += counts[i];
+                if (total >= rank) {
+                    auto value = bucket_max(i);
+                    return value < max ? value : max;
+                }
+            }
+            return max;
+        }
+
+        std::array<uint64_t, BucketCount> counts = {};
+        uint64_t count = {0};
+        uint64_t total = {0};
+        uint64_t max = {0};
+    };
+}
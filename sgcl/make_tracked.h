@@ -6,6 +6,9 @@
 #pragma once
 
 #include "priv/maker.h"
+#include "types.h"
+
+#include <algorithm>
 
 namespace sgcl {
     template<class T, class ...A, std::enable_if_t<!std::is_array_v<T>, int> = 0>
@@ -14,6 +17,13 @@ namespace sgcl {
         return Priv::Maker<T>::make_tracked(std::forward<A>(a)...);
     }
 
+    // writes count unique_ptr<T> to out, the arguments are passed to every constructor
+    template<class T, class O, class ...A, std::enable_if_t<!std::is_array_v<T>, int> = 0>
+    O make_tracked_n(size_t count, O out, const A&... a) {
+        static_assert(sizeof(T) <= Priv::PageDataSize, "Object is too large");
+        return Priv::Maker<T>::make_tracked_n(count, out, a...);
+    }
+
     template<class T, std::enable_if_t<std::is_array_v<T>, int> = 0>
     auto make_tracked(size_t size) {
         return Priv::Maker<T>::make_tracked(size);
@@ -28,4 +38,37 @@ namespace sgcl {
     auto make_tracked(std::initializer_list<std::remove_extent_t<T>> init) {
         return Priv::Maker<T>::make_tracked(init);
     }
+
+    // the elements are default initialized and their memory is not cleared if they hold no tracked pointers
+    template<class T, std::enable_if_t<std::is_array_v<T>, int> = 0>
+    auto make_tracked_for_overwrite(size_t size) {
+        return Priv::Maker<T>::make_tracked_for_overwrite(size);
+    }
+
+    namespace Priv {
+        template<class P>
+        void Reallocate(P& p, size_t count) {
+            using T = typename P::element_type;
+            auto size = p.size();
+            if (count == size || (size && count > size && Maker<T[]>::grow(p.get(), count))) {
+                return;
+            }
+            auto data = Maker<T[]>::make_tracked(count);
+            std::move(p.get(), p.get() + std::min(size, count), data.get());
+            p = std::move(data);
+        }
+    }
+
+    // resizes the array of the pointer, the elements up to the smaller size are kept and the new ones are
+    // initialized like by make_tracked<T[]>(count); a large array grows in place if its memory allows,
+    // otherwise the elements are moved to a new array and other pointers keep the old one
+    template<class T>
+    void reallocate(tracked_ptr<T[]>& p, size_t count) {
+        Priv::Reallocate(p, count);
+    }
+
+    template<class T>
+    void reallocate(root_ptr<T[]>& p, size_t count) {
+        Priv::Reallocate(p, count);
+    }
 }
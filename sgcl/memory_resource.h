@@ -0,0 +1,130 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "priv/memory_pages.h"
+
+#include <algorithm>
+#include <memory_resource>
+#include <new>
+
+namespace sgcl {
+    // untracked memory for std::pmr containers; small blocks are taken from pages of the block allocator
+    // of the thread and cached by threads in power of two sizes, larger ones come from operator new;
+    // all instances share the blocks, a block can be freed by any thread
+    class memory_resource : public std::pmr::memory_resource {
+    private:
+        using Pages = Priv::Memory_pages;
+
+        void* do_allocate(size_t bytes, size_t alignment) override {
+            auto size = std::max(bytes, alignment);
+            if (size <= Pages::MaxSize) {
+                return Pages::alloc(Pages::class_of(size));
+            }
+            return ::operator new(bytes, std::align_val_t(alignment));
+        }
+
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+            auto size = std::max(bytes, alignment);
+            if (size <= Pages::MaxSize) {
+                Pages::free(p, Pages::class_of(size));
+            } else {
+                ::operator delete(p, std::align_val_t(alignment));
+            }
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& r) const noexcept override {
+            return dynamic_cast<const memory_resource*>(&r) != nullptr;
+        }
+    };
+
+    inline memory_resource* get_memory_resource() noexcept {
+        static memory_resource resource;
+        return &resource;
+    }
+
+    // the memory of one owner, meant as a member of a tracked object: blocks are taken from pages in order
+    // and not reused, all pages go back to the block allocator at once when the resource is destroyed,
+    // so the memory of an unreachable object is freed in bulk when the collector destroys it;
+    // not synchronized, like std::pmr::monotonic_buffer_resource
+    class object_memory_resource : public std::pmr::memory_resource {
+    public:
+        object_memory_resource() = default;
+        object_memory_resource(const object_memory_resource&) = delete;
+        object_memory_resource& operator=(const object_memory_resource&) = delete;
+
+        ~object_memory_resource() noexcept override {
+            release();
+        }
+
+        void release() noexcept {
+            if (_pages) {
+                Priv::Block_allocator::free(_pages);
+                _pages = nullptr;
+            }
+            while(_large) {
+                auto next = _large->next;
+                ::operator delete(_large->memory, std::align_val_t(_large->alignment));
+                _large = next;
+            }
+            _position = _end = 0;
+        }
+
+    private:
+        // the header of a block larger than half of a page, kept right before the block
+        struct Large {
+            Large* next;
+            void* memory;
+            size_t alignment;
+        };
+
+        static constexpr size_t MaxSize = Priv::PageDataSize / 2;
+
+        Priv::Data_page* _pages = {nullptr};
+        Large* _large = {nullptr};
+        uintptr_t _position = {0};
+        uintptr_t _end = {0};
+
+        void* do_allocate(size_t bytes, size_t alignment) override {
+            if (bytes > MaxSize || alignment > MaxSize / 2) {
+                return _alloc_large(bytes, alignment);
+            }
+            auto position = (_position + alignment - 1) & ~(uintptr_t)(alignment - 1);
+            if (!_position || position + bytes > _end) {
+                // the page list is linked through the first word of the page data, see Block_allocator
+                bool zeroed;
+                auto page = Priv::Current_thread().block_allocator().alloc(zeroed);
+                page->next = _pages;
+                _pages = page;
+                _position = (uintptr_t)page->data + sizeof(Priv::Data_page*);
+                _end = (uintptr_t)page + Priv::PageSize;
+                position = (_position + alignment - 1) & ~(uintptr_t)(alignment - 1);
+            }
+            _position = position + bytes;
+            return (void*)position;
+        }
+
+        void do_deallocate(void*, size_t, size_t) override {
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& r) const noexcept override {
+            return this == &r;
+        }
+
+        void* _alloc_large(size_t bytes, size_t alignment) {
+            alignment = std::max(alignment, alignof(Large));
+            auto offset = (sizeof(Large) + alignment - 1) & ~(alignment - 1);
+            auto memory = ::operator new(offset + bytes, std::align_val_t(alignment));
+            auto block = (uintptr_t)memory + offset;
+            auto large = (Large*)block - 1;
+            large->next = _large;
+            large->memory = memory;
+            large->alignment = alignment;
+            _large = large;
+            return (void*)block;
+        }
+    };
+}
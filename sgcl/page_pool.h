@@ -0,0 +1,55 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "priv/thread.h"
+
+namespace sgcl {
+    // a set of pages not shared with other allocations, the freed places are reused by the pool only;
+    // after the pool ends the collector frees each page without reachable objects at once, the pages
+    // with reachable objects are swept and reused normally; no pool scope can be active at that time;
+    // the objects of a pool are still marked and swept by the one collector with all other objects
+    class page_pool {
+    public:
+        page_pool()
+        : _pool(new Priv::Page_pool) {
+        }
+
+        page_pool(const page_pool&) = delete;
+        page_pool& operator=(const page_pool&) = delete;
+
+        ~page_pool() noexcept {
+            assert(!_pool->scopes.load(std::memory_order_relaxed));
+            _pool->ended.store(true, std::memory_order_release);
+        }
+
+    private:
+        Priv::Page_pool* const _pool;
+
+        friend class page_pool_scope;
+    };
+
+    // small objects made by the thread within the scope are allocated on pages of the pool
+    class page_pool_scope {
+    public:
+        explicit page_pool_scope(page_pool& p) noexcept {
+            _arena.pool = p._pool;
+            _arena.pool->scopes.fetch_add(1, std::memory_order_relaxed);
+            Priv::Current_thread().enter_arena(_arena);
+        }
+
+        page_pool_scope(const page_pool_scope&) = delete;
+        page_pool_scope& operator=(const page_pool_scope&) = delete;
+
+        ~page_pool_scope() noexcept {
+            Priv::Current_thread().leave_arena(_arena);
+            _arena.pool->scopes.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+    private:
+        Priv::Thread::Arena _arena;
+    };
+}
@@ -0,0 +1,24 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "collector_tracer.h"
+
+#include <perfetto.h>
+
+namespace sgcl {
+    // slices of the Perfetto SDK track events on the GC thread track, the application defines
+    // the "sgcl" category with PERFETTO_DEFINE_CATEGORIES and initializes the SDK
+    struct perfetto_tracer : collector_tracer {
+        void begin(collector_phase phase) noexcept override {
+            TRACE_EVENT_BEGIN("sgcl", perfetto::StaticString{name(phase)});
+        }
+
+        void end(collector_phase, int64_t objects, int64_t pages) noexcept override {
+            TRACE_EVENT_END("sgcl", "objects", objects, "pages", pages);
+        }
+    };
+}
@@ -0,0 +1,27 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "priv/thread.h"
+
+namespace sgcl {
+    // objects reachable while the guard is held stay alive until it ends, so unsafe_ptr can be used
+    // to traverse them; the collector does not sweep until the guards begun before the end of its
+    // marking are released, guards are meant to be short and must not wait for a collection
+    class pin_guard {
+    public:
+        pin_guard() noexcept {
+            Priv::Current_thread().pin();
+        }
+
+        pin_guard(const pin_guard&) = delete;
+        pin_guard& operator=(const pin_guard&) = delete;
+
+        ~pin_guard() noexcept {
+            Priv::Current_thread().unpin();
+        }
+    };
+}
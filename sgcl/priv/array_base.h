@@ -24,7 +24,8 @@ namespace sgcl {
             }
 
             std::atomic<Array_metadata*> metadata = {nullptr};
-            const size_t count;
+            // large arrays grow in place, the new elements are initialized before the count is stored
+            std::atomic<size_t> count;
         };
     }
 }
@@ -5,20 +5,70 @@
 //------------------------------------------------------------------------------
 #pragma once
 
+#include "../configuration.h"
 #include "data_page.h"
 
+#include <new>
+
+#if SGCL_OS_BLOCKS || SGCL_NUMA_NODES > 1
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 namespace sgcl {
     namespace Priv {
+        inline unsigned Current_numa_node() noexcept {
+#if SGCL_NUMA_NODES > 1 && defined(SYS_getcpu)
+            unsigned cpu = 0;
+            unsigned node = 0;
+            if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+                return node % SGCL_NUMA_NODES;
+            }
+#endif
+            return 0;
+        }
+
         struct Block {
+#if SGCL_OS_BLOCKS
+            static constexpr size_t RegionSize = 0x200000;
+            // the first page of a region holds the block header
+            static constexpr size_t PageCount = RegionSize / PageSize - 1;
+#else
             static constexpr size_t PageCount = 15;
+#endif
 
-            Block() noexcept {
+            Block() noexcept
+                : node(Current_numa_node()) {
                 Data_page* data = (Data_page*)(this + 1);
                 for (size_t i = 0; i < PageCount; ++i) {
                     data[i].block = this;
                 }
             }
 
+#if SGCL_OS_BLOCKS
+            // the region is aligned to its size, so it can be backed by one huge page
+            static void* operator new(size_t) {
+                auto mem = mmap(nullptr, RegionSize * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (mem == MAP_FAILED) {
+                    throw std::bad_alloc();
+                }
+                auto region = ((uintptr_t)mem + RegionSize - 1) & ~(RegionSize - 1);
+                if (region > (uintptr_t)mem) {
+                    munmap(mem, region - (uintptr_t)mem);
+                }
+                munmap((void*)(region + RegionSize), (uintptr_t)mem + RegionSize - region);
+#if SGCL_HUGE_PAGES && defined(MADV_HUGEPAGE)
+                madvise((void*)region, RegionSize, MADV_HUGEPAGE);
+#endif
+                Block* block = (Block*)(region + PageSize) - 1;
+                return block;
+            }
+
+            static void operator delete(void* p, size_t) noexcept {
+                munmap((void*)((uintptr_t)p & ~(RegionSize - 1)), RegionSize);
+            }
+#else
             static void* operator new(size_t) {
                 auto size = sizeof(void*) + sizeof(Block) + sizeof(Data_page) * (PageCount + 1);
                 void* mem = ::operator new(size);
@@ -32,9 +82,14 @@ namespace sgcl {
             static void operator delete(void* p, size_t) noexcept {
                 ::operator delete(*((void**)p - 1));
             }
+#endif
 
+            // the free pages of the block and the blocks of a node with free pages, see Block_allocator
+            Data_page* free_pages = {nullptr};
+            unsigned free_count = {0};
+            Block* prev = {nullptr};
             Block* next = {nullptr};
-            unsigned page_count = {0};
+            const unsigned node;
         };
     }
 }
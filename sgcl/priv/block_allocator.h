@@ -8,8 +8,21 @@
 #include "block.h"
 #include "pointer_pool.h"
 
+#include <array>
+#include <mutex>
+
+#if SGCL_LATENCY_HISTOGRAMS
+#include "latency.h"
+#endif
+
 namespace sgcl {
     namespace Priv {
+        // the blocks of a NUMA node with free pages, the pages of the first one are taken first
+        struct alignas(64) Free_blocks {
+            std::mutex mutex;
+            Block* blocks = {nullptr};
+        };
+
         struct Block_allocator {
             using Pointer_pool = Pointer_pool<Block::PageCount, PageSize>;
 
@@ -25,78 +38,100 @@ namespace sgcl {
                 }
             }
             
-            Data_page* alloc() {
+            // the pages of a new block mapped from the OS are zero filled
+            Data_page* alloc(bool& zeroed) {
                 if (_pointer_pool.is_empty()) {
-                    while (_lock.test_and_set(std::memory_order_acquire));
-                    auto page = _empty_pages;
-                    if (page) {
-                        _empty_pages = page->next;
-                    }
-                    _lock.clear(std::memory_order_release);
-                    if (page) {
-                        return page;
+                    if (_take_pages()) {
+                        _zeroed = false;
                     } else {
+#if SGCL_LATENCY_HISTOGRAMS
+                        Latency_scope latency(latency_event::new_block);
+#endif
                         auto block = new Block;
                         _pointer_pool.fill(block + 1);
+                        _zeroed = SGCL_OS_BLOCKS;
                     }
                 }
+                zeroed = _zeroed;
                 return (Data_page*)_pointer_pool.alloc();
             }
-            
+
+            // the free pages are kept by their blocks and counted as they come, a block is deleted
+            // once all its pages are free; the lock of a node is held for the freed pages only
             static void free(Data_page* page) {
-                auto last = page;
-                while(last->next) {
-                    last = last->next;
-                }
-                while (_lock.test_and_set(std::memory_order_acquire));
-                last->next = _empty_pages;
-                _empty_pages = nullptr;
-                _lock.clear(std::memory_order_release);
-                Block* block = nullptr;
-                auto p = page;
-                while(p) {
-                    Block* b = p->block;
-                    if (!b->page_count) {
-                        b->next = block;
-                        block = b;
-                    }
-                    ++b->page_count;
-                    p = p->next;
-                }
-                Data_page* prev = nullptr;
-                p = page;
-                while(p) {
-                    auto next = p->next;
-                    Block* b = p->block;
-                    if (b->page_count == Block::PageCount) {
-                        if (!prev) {
-                            page = next;
-                        } else {
-                            prev->next = next;
+                Block* empty_blocks = nullptr;
+                while(page) {
+                    auto& node = _nodes[page->block->node];
+                    std::lock_guard<std::mutex> lock(node.mutex);
+                    do {
+                        auto next = page->next;
+                        auto block = page->block;
+                        page->next = block->free_pages;
+                        block->free_pages = page;
+                        if (++block->free_count == Block::PageCount) {
+                            _unlink(node, block);
+                            block->next = empty_blocks;
+                            empty_blocks = block;
+                        } else if (block->free_count == 1) {
+                            _link(node, block);
                         }
-                    } else {
-                        prev = p;
-                    }
-                    p = next;
+                        page = next;
+                    } while(page && &_nodes[page->block->node] == &node);
                 }
-                while (_lock.test_and_set(std::memory_order_acquire));
-                _empty_pages = page;
-                _lock.clear(std::memory_order_release);
-                while(block) {
-                    auto next = block->next;
-                    if (block->page_count == Block::PageCount) {
-                        delete block;
-                    } else {
-                        block->page_count = 0;
-                    }
-                    block = next;
+                while(empty_blocks) {
+                    auto next = empty_blocks->next;
+                    delete empty_blocks;
+                    empty_blocks = next;
                 }
             }
 
         private:
-            inline static std::atomic_flag _lock = ATOMIC_FLAG_INIT;
-            inline static Data_page* _empty_pages = {nullptr};
+            // the pool takes as many free pages of one block as it holds
+            bool _take_pages() {
+                auto& node = _nodes[Current_numa_node()];
+                std::lock_guard<std::mutex> lock(node.mutex);
+                auto block = node.blocks;
+                if (!block) {
+                    return false;
+                }
+                auto page = block->free_pages;
+                while(page && !_pointer_pool.is_full()) {
+                    auto next = page->next;
+                    _pointer_pool.free(page);
+                    --block->free_count;
+                    page = next;
+                }
+                block->free_pages = page;
+                if (!page) {
+                    _unlink(node, block);
+                }
+                return true;
+            }
+
+            static void _link(Free_blocks& node, Block* block) noexcept {
+                block->prev = nullptr;
+                block->next = node.blocks;
+                if (node.blocks) {
+                    node.blocks->prev = block;
+                }
+                node.blocks = block;
+            }
+
+            static void _unlink(Free_blocks& node, Block* block) noexcept {
+                if (block->prev) {
+                    block->prev->next = block->next;
+                } else {
+                    node.blocks = block->next;
+                }
+                if (block->next) {
+                    block->next->prev = block->prev;
+                }
+                block->prev = block->next = nullptr;
+            }
+
+            inline static std::array<Free_blocks, SGCL_NUMA_NODES> _nodes;
             Pointer_pool _pointer_pool;
+            bool _zeroed = {false};
         };
     }
 }
@@ -6,22 +6,81 @@
 #pragma once
 
 #include "../configuration.h"
+#include "data_page.h"
 #include "types.h"
 
+#include <algorithm>
 #include <array>
-#include <vector>
 
 namespace sgcl {
     namespace Priv {
         struct Child_pointers {
-            using Map = std::array<std::atomic<uint8_t>, MaxTypeNumber / sizeof(Pointer) / 8>;
-            using Vector = std::vector<ptrdiff_t>;
+            using Map = std::array<std::atomic<uint8_t>, std::max(MaxMappedObjectSize, PageSize) / sizeof(Pointer) / 8>;
+
+            // the offsets of pointers found in the map or declared with SGCL_TRACE
+            struct Offsets {
+                const ptrdiff_t* begin() const noexcept {
+                    return data;
+                }
+
+                const ptrdiff_t* end() const noexcept {
+                    return data + count;
+                }
+
+                size_t size() const noexcept {
+                    return count;
+                }
+
+                const ptrdiff_t* data;
+                size_t count;
+            };
 
             constexpr Child_pointers(bool f) noexcept
             : final(f) {
             };
 
-            Vector* offsets = {nullptr};
+            constexpr Child_pointers(bool f, const Offsets* o) noexcept
+            : offsets(o)
+            , final(f) {
+            };
+
+            // declared offsets are checked against the ones found during the first construction
+            bool map_matches_offsets() const noexcept {
+                auto o = offsets.load(std::memory_order_acquire);
+                if (!o) {
+                    return true;
+                }
+                size_t count = 0;
+                for (unsigned index = 0; index < map.size(); ++index) {
+                    auto flags = map[index].load(std::memory_order_relaxed);
+                    for (unsigned i = 0; flags && i < 8; ++i) {
+                        if (flags & (1 << i)) {
+                            auto offset = (ptrdiff_t)((index * 8 + i) * sizeof(Pointer));
+                            if (std::find(o->begin(), o->end(), offset) == o->end()) {
+                                return false;
+                            }
+                            ++count;
+                        }
+                    }
+                }
+                return count == o->size();
+            }
+
+            // no pointers were declared or found in the first object, known once final is set
+            bool is_empty() const noexcept {
+                auto o = offsets.load(std::memory_order_acquire);
+                if (o) {
+                    return !o->size();
+                }
+                for (auto& flags : map) {
+                    if (flags.load(std::memory_order_relaxed)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            std::atomic<const Offsets*> offsets = {nullptr};
             Map map = {};
             std::atomic<bool> final;
         };
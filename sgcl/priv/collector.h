@@ -5,16 +5,37 @@
 //------------------------------------------------------------------------------
 #pragma once
 
+#include "../collector_policy.h"
 #include "../configuration.h"
+#include "../heap_snapshot.h"
+#include "../shutdown_mode.h"
 #include "array.h"
+#include "compactor.h"
 #include "counter.h"
+#include "ephemeron_table.h"
+#include "mark_queue.h"
+#include "mark_stack.h"
+#include "phase_tracer.h"
+#include "root_blocks.h"
+#include "simd.h"
+#include "stats.h"
+#include "sweeper.h"
 #include "timer.h"
 #include "thread.h"
 #include "unique_ptr.h"
+#include "weak_table.h"
 #include "maker.h"
 
+#include <algorithm>
 #include <condition_variable>
+#include <iterator>
+#include <map>
 #include <thread>
+#include <vector>
+
+#if SGCL_LATENCY_HISTOGRAMS
+#include "latency.h"
+#endif
 
 #if SGCL_LOG_PRINT_LEVEL
 #include <iostream>
@@ -24,11 +45,15 @@ namespace sgcl {
     namespace Priv {
         inline Collector& Collector_instance();
 
+        static_assert(!SGCL_COOPERATIVE || (!SGCL_MARKING_THREADS && !SGCL_SWEEPING_THREADS), "SGCL_COOPERATIVE does not use marking and sweeping threads");
+
         struct Collector {
             Collector() {
                 if (!created()) {
                     _created = true;
+#if !SGCL_COOPERATIVE
                     std::thread([this]{_main_loop();}).detach();
+#endif
                 }
             }
 
@@ -41,37 +66,101 @@ namespace sgcl {
                 std::cout << "[sgcl] force collect " << (wait ? "and wait " : "") << "from id: " << std::this_thread::get_id() << std::endl;
 #endif
                 if (wait) {
+#if SGCL_LATENCY_HISTOGRAMS
+                    Latency_scope latency(latency_event::forced_collect_wait);
+#endif
                     std::unique_lock<std::mutex> lock(_mutex);
                     if (!_terminating.load(std::memory_order_relaxed)) {
                         _forced_collect_count.store(3, std::memory_order_release);
-                        _forced_collect_cv.wait(lock, [this]{
-                            return _forced_collect_count.load(std::memory_order_relaxed) == 0;
-                        });
+                        _wait_for_forced(lock);
                     }
                 } else {
                     _forced_collect_count.store(3, std::memory_order_release);
                 }
+                Thread::wake_collector();
             }
 
             int64_t live_objects_number() const noexcept {
                 return _live_objects_number.load(std::memory_order_acquire);
             }
 
+            collector_stats stats() const noexcept {
+                return _stats.load();
+            }
+
+            void set_policy(const collector_policy& policy) {
+                std::lock_guard<std::mutex> lock(_policy_mutex);
+                _new_policy = policy;
+                _policy_changed.store(true, std::memory_order_release);
+                Thread::wake_collector();
+            }
+
+            collector_policy policy() const {
+                std::lock_guard<std::mutex> lock(_policy_mutex);
+                return _new_policy;
+            }
+
+            void set_tracer(std::shared_ptr<collector_tracer> tracer) {
+                _tracer.set(std::move(tracer));
+            }
+
+            void set_destruction_executor(Sweeper::Executor executor, bool all_types) {
+                _sweeper.set_executor(std::move(executor), all_types);
+            }
+
+            void set_weak_callback(std::function<void(size_t)> callback) {
+                Weak_table::set_callback(std::move(callback));
+            }
+
             void live_objects(Unique_ptr<Tracked_ptr[]>& array) noexcept {
                 std::unique_lock<std::mutex> lock(_mutex);
                 if (!_terminating.load(std::memory_order_relaxed)) {
                     _live_objects_ref.store(&array, std::memory_order_relaxed);
                     _forced_collect_count.store(3, std::memory_order_release);
-                    _forced_collect_cv.wait(lock, [this]{
-                        return _forced_collect_count.load(std::memory_order_relaxed) == 0;
-                    });
+                    _wait_for_forced(lock);
                     _live_objects_ref.store(nullptr, std::memory_order_release);
                 }
             }
 
-            void static terminate() noexcept {
+            // the objects are moved at the end of one full cycle, see collector::compact()
+            size_t compact(double occupancy) noexcept {
+                std::unique_lock<std::mutex> lock(_mutex);
+                if (_terminating.load(std::memory_order_relaxed)) {
+                    return 0;
+                }
+                _compaction_ref.store(occupancy, std::memory_order_relaxed);
+                _forced_collect_count.store(2, std::memory_order_release);
+                _wait_for_forced(lock);
+                _compaction_ref.store(0, std::memory_order_release);
+                return _compacted;
+            }
+
+            // the objects are visited in one full cycle, without parallel marking
+            void visit_heap(heap_visitor& visitor) noexcept {
+                std::unique_lock<std::mutex> lock(_mutex);
+                if (!_terminating.load(std::memory_order_relaxed)) {
+                    _heap_visitor_ref.store(&visitor, std::memory_order_relaxed);
+                    _forced_collect_count.store(2, std::memory_order_release);
+                    _wait_for_forced(lock);
+                    _heap_visitor_ref.store(nullptr, std::memory_order_release);
+                }
+            }
+
+#if SGCL_COOPERATIVE
+            // runs the collector for up to the budget, returns false if no cycle was completed
+            // or another thread is running a step
+            bool step(double budget) {
+                std::unique_lock<std::mutex> lock(_step_mutex, std::try_to_lock);
+                if (!lock) {
+                    return false;
+                }
+                return _step(Deadline(budget));
+            }
+#endif
+
+            void static terminate(shutdown_mode mode = shutdown_mode::finalize) noexcept {
                 if (created()) {
-                    Collector_instance()._terminate();
+                    Collector_instance()._terminate(mode);
                 }
             }
 
@@ -84,6 +173,11 @@ namespace sgcl {
             }
 
         private:
+            static constexpr int64_t MinLiveSize = PageSize;
+            static constexpr int64_t MinLiveCount = MinLiveSize / sizeof(uintptr_t) * 2;
+            static constexpr unsigned ArenaCycles = 2;
+            static constexpr int FinalizationCycles = 5;
+
             Counter _alloc_counter() const {
                 Counter allocated;
                 auto data = Thread::threads_data.load(std::memory_order_acquire);
@@ -96,8 +190,9 @@ namespace sgcl {
             }
 
             inline static void _update_child_offsets(Child_pointers& childs) {
-                if (!childs.offsets && childs.final.load(std::memory_order_acquire)) {
-                    childs.offsets = new Child_pointers::Vector;
+                auto offsets = childs.offsets.load(std::memory_order_acquire);
+                if (!offsets && childs.final.load(std::memory_order_acquire)) {
+                    std::vector<ptrdiff_t> found;
                     for (unsigned index = 0; index < childs.map.size(); ++index) {
                         auto flags = childs.map[index].load(std::memory_order_relaxed);
                         if (flags) {
@@ -105,20 +200,30 @@ namespace sgcl {
                                 auto mask = uint8_t(1) << i;
                                 if (flags & mask) {
                                     auto offset = (index * 8 + i) * sizeof(Pointer);
-                                    childs.offsets->emplace_back(offset);
+                                    found.emplace_back(offset);
                                 }
                             }
                         }
                     }
+                    auto data = new ptrdiff_t[found.size()];
+                    std::copy(found.begin(), found.end(), data);
+                    auto new_offsets = new Child_pointers::Offsets{data, found.size()};
+                    // marker threads can race here, the first one wins
+                    if (!childs.offsets.compare_exchange_strong(offsets, new_offsets, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                        delete[] data;
+                        delete new_offsets;
+                    }
                 }
             }
 
             void _check_threads() noexcept {
+                _cycle_stats.threads = 0;
                 Thread::Data* prev = nullptr;
                 auto thread = Thread::threads_data.load(std::memory_order_acquire);
                 while(thread) {
                     auto next = thread->next;
                     if (thread->is_used.load(std::memory_order_relaxed)) {
+                        _cycle_stats.threads += !thread->is_cached.load(std::memory_order_relaxed);
                         prev = thread;
                     } else {
                         if (!prev) {
@@ -135,160 +240,218 @@ namespace sgcl {
                         }
                         _allocated_rest.count += thread->alloc_count.load(std::memory_order_relaxed);
                         _allocated_rest.size += thread->alloc_size.load(std::memory_order_relaxed);
+#if SGCL_GENERATIONAL
+                        _remembered_slots.insert(_remembered_slots.end(), thread->remembered_slots.begin(), thread->remembered_slots.end());
+#endif
                         delete thread;
                     }
                     thread = next;
                 }
             }
 
-            void _update_states() {
+            // returns true if the page has to be visited in the next cycle as well
+            static bool _update_states(Page* page, bool atomic) noexcept {
+                bool pending = false;
+                auto states = page->states();
+                auto flags = page->flags();
+                auto count = page->metadata->object_count;
+                State_scan::for_each(states, count, State::Reachable, State::ReachableAtomic, [&](unsigned i) {
+                    auto index = Page::flag_index_of(i);
+                    auto mask = Page::flag_mask_of(i);
+                    auto& flag = flags[index];
+                    if (flag.registered & mask) {
+                        auto state = states[i].load(std::memory_order_relaxed);
+                        if (state > State::Reachable) {
+                            if (atomic) {
+                                states[i].store((State)(state - 1), std::memory_order_relaxed);
+                            }
+                        } else {
+                            states[i].store(State::Used, std::memory_order_relaxed);
+                        }
+                        pending = true;
+                    }
+                });
+                return pending;
+            }
+
+            // returns true if a registered object still has to be aged
+            bool _register_objects(Page* page) noexcept {
+                bool pending = false;
+                auto states = page->states();
+                auto flags = page->flags();
+                auto count = page->flags_count();
+                for (unsigned i = 0; i < count; ++i) {
+                    auto& flag = flags[i];
+                    auto unregistered = ~flag.registered;
+                    if (i == count - 1) {
+                        auto object_count = (i + 1) * Page::FlagBitCount;
+                        if (object_count > page->metadata->object_count) {
+                            unregistered &= ~Page::Flag(0) >> (object_count - page->metadata->object_count);
+                        }
+                    }
+                    For_each_bit(unregistered, [&](unsigned j) {
+                        auto index = i * Page::FlagBitCount + j;
+                        assert(index < page->metadata->object_count);
+                        auto state = states[index].load(std::memory_order_relaxed);
+                        if (state >= State::Reachable && state <= State::BadAlloc) {
+                            flag.registered |= Page::Flag(1) << j;
+                            pending |= state <= State::ReachableAtomic;
+                            if (!page->registered) {
+                                page->registered = true;
+                                page->next_registered = _registered_pages;
+                                _registered_pages = page;
+#if SGCL_GENERATIONAL
+                                _heap_pages[page->data] = page;
+#endif
+                            }
+                        }
+                    });
+                }
+                return pending;
+            }
+
+            // only pages with changed states are scanned, see Page::set_dirty()
+            void _update_pages() {
                 static Timer timer;
                 bool atomic = _terminating;
                 if (timer.duration() >= DeletionDelayMsec / (State::ReachableAtomic - 2)) {
                     atomic = true;
                     timer.reset();
                 }
+                Timer phase_timer;
                 std::atomic_thread_fence(std::memory_order_acquire);
-                auto page = _registered_pages;
-                while(page) {
-                    auto states = page->states();
-                    auto flags = page->flags();
-                    auto count = page->metadata->object_count;
-                    for (unsigned i = 0; i < count; ++i) {
-                        auto state = states[i].load(std::memory_order_relaxed);
-                        if (state >= State::Reachable && state <= State::ReachableAtomic) {
-                            auto index = Page::flag_index_of(i);
-                            auto mask = Page::flag_mask_of(i);
-                            auto& flag = flags[index];
-                            if (flag.registered & mask) {
-                                if (state > State::Reachable) {
-                                    if (atomic) {
-                                        states[i].store((State)(state - 1), std::memory_order_relaxed);
-                                    }
-                                } else {
-                                    states[i].store(State::Used, std::memory_order_relaxed);
-                                }
-                            }
-                        }
+                // the flags are cleared at the end of the previous cycle, see _release_unused_pages()
+#if SGCL_GENERATIONAL
+                if (_minor) {
+                    for (auto page = _registered_pages; page; page = page->next_registered) {
+                        page->mark_old();
+                    }
+                }
+#endif
+                // all states are aged before any object is registered, pages dirtied
+                // in the meantime are taken again so new objects are registered as well
+                _dirty_pages.clear();
+                _take_dirty_pages();
+                auto aged_count = _dirty_pages.size();
+                _tracer.begin(collector_phase::update_states);
+                for (size_t i = 0; i < aged_count; ++i) {
+                    if (_update_states(_dirty_pages[i], atomic)) {
+                        _dirty_pages[i]->set_dirty();
                     }
-                    page = page->next_registered;
                 }
+                _tracer.end(collector_phase::update_states, 0, aged_count);
+                _cycle_stats.last_states_time = phase_timer.duration();
+                phase_timer.reset();
+                _tracer.begin(collector_phase::register_objects);
+                _take_dirty_pages();
+                for (size_t i = 0; i < _dirty_pages.size(); ++i) {
+                    auto page = _dirty_pages[i];
+                    if (_register_objects(page) || i >= aged_count) {
+                        page->set_dirty();
+                    }
+                }
+                for (auto page : _dirty_pages) {
+                    if (page->registered) {
+                        _add_release_candidate(page);
+                    }
+                }
+                _tracer.end(collector_phase::register_objects, 0, _dirty_pages.size());
+                _cycle_stats.last_register_time = phase_timer.duration();
                 std::atomic_thread_fence(std::memory_order_release);
             }
 
-            void _register_objects() noexcept {
-                Page* prev = nullptr;
-                auto page = Object_allocator::pages.load(std::memory_order_acquire);
+            void _take_dirty_pages() {
+                auto page = Page::dirty_pages.exchange(nullptr, std::memory_order_acquire);
                 while(page) {
-                    auto next = page->next;
-                    if (page->is_used) {
-                        page->clear_flags();
-                        auto states = page->states();
-                        auto flags = page->flags();
-                        auto count = page->flags_count();
-                        for (unsigned i = 0; i < count; ++i) {
-                            auto& flag = flags[i];
-                            auto unregistered = ~flag.registered;
-                            if (unregistered) {
-                                auto flagBitCount = Page::FlagBitCount;
-                                if (i == count - 1) {
-                                    auto object_count = (i + 1) * Page::FlagBitCount;
-                                    if (object_count > page->metadata->object_count) {
-                                        flagBitCount -= object_count - page->metadata->object_count;
-                                    }
-                                }
-                                for (unsigned j = 0; j < flagBitCount; ++j) {
-                                    auto mask = Page::Flag(1) << j;
-                                    if (unregistered & mask) {
-                                        auto index = i * Page::FlagBitCount + j;
-                                        assert(index < page->metadata->object_count);
-                                        auto state = states[index].load(std::memory_order_relaxed);
-                                        if (state >= State::Reachable && state <= State::BadAlloc) {
-                                            flag.registered |= mask;
-                                            if (!page->registered) {
-                                                page->registered = true;
-                                                page->next_registered = _registered_pages;
-                                                _registered_pages = page;
-                                            }
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                        prev = page;
+                    auto next = page->next_dirty;
+                    page->dirty.exchange(false, std::memory_order_acq_rel);
+                    if (!page->is_used) {
+                        Page::destroy(page);
                     } else {
-                        if (!prev) {
-                            auto rpage = page;
-                            if (!Object_allocator::pages.compare_exchange_strong(rpage, next, std::memory_order_relaxed, std::memory_order_acquire)) {
-                                while(rpage->next != page) {
-                                    rpage = rpage->next;
-                                }
-                                prev = rpage;
-                            }
-                        }
-                        if (prev) {
-                            prev->next = next; // NOLINT(clang-analyzer-cplusplus.NewDelete)
-                        }
-                        delete page;
+                        _dirty_pages.emplace_back(page);
                     }
                     page = next;
                 }
             }
 
-            void _mark(const void* ptr) noexcept {
+            void _mark(const void* ptr, Mark_queue* queue = nullptr) noexcept {
                 if (ptr) {
+                    if (_heap_edges) {
+                        _heap_edges->emplace_back(Page::base_address_of(ptr));
+                    }
+#if SGCL_MARK_STACK
+                    // checked when popped, see Mark_stack
+                    if (!queue && _mark_stack_active) {
+                        _mark_stack.push(ptr);
+                        return;
+                    }
+#endif
                     auto page = Page::page_of(ptr);
                     auto index = page->index_of(ptr);
                     auto flag_index = Page::flag_index_of(index);
                     auto mask = Page::flag_mask_of(index);
                     auto& flag = page->flags()[flag_index];
-                    if ((flag.registered & ~flag.marked & ~flag.reachable & mask)) {
-                        flag.reachable |= mask;
-                        if (!page->reachable) {
-                            page->reachable = true;
-                            page->next_reachable = _reachable_pages;
-                            _reachable_pages = page;
+                    auto reachable = flag.reachable.load(std::memory_order_relaxed);
+                    if ((flag.registered & ~flag.marked.load(std::memory_order_relaxed) & ~reachable & mask)) {
+                        if (!queue) {
+                            flag.reachable.store(reachable | mask, std::memory_order_relaxed);
+                            if (!page->reachable.load(std::memory_order_relaxed)) {
+                                page->reachable.store(true, std::memory_order_relaxed);
+                                page->next_reachable = _reachable_pages;
+                                _reachable_pages = page;
+                            }
+                        } else if (!(flag.reachable.fetch_or(mask) & mask) && !page->reachable.exchange(true)) {
+                            _pending_pages.fetch_add(1, std::memory_order_relaxed);
+                            queue->push(page);
+                            if (_idle_markers.load(std::memory_order_seq_cst)) {
+                                _wake_markers(false);
+                            }
                         }
                     }
                 }
             }
 
+            void _mark_root(const void* ptr) noexcept {
+                if constexpr(Phase_tracer::Enabled) {
+                    _traced_objects += ptr != nullptr;
+                }
+                if (_heap_visitor && ptr) {
+                    _heap_visitor->visit_root(Page::base_address_of(ptr));
+                }
+                _mark(ptr);
+            }
+
             void _mark_stack_roots() noexcept {
                 auto data = Thread::threads_data.load(std::memory_order_acquire);
                 while(data) {
-                    for (auto& p: data->stack_roots_allocator->pages) {
-                        auto page = p.load(std::memory_order_acquire);
-                        if (page) {
-                            for (auto& p: *page) {
-                                _mark(p.load(std::memory_order_acquire));
-                            }
-                        }
-                    }
+                    data->stack_roots_allocator->for_each([this](Pointer& p) {
+                        _mark_root(p.load(std::memory_order_acquire));
+                    });
                     data = data->next;
                 }
             }
 
             void _mark_heap_roots() noexcept {
-                auto node = Heap_roots_allocator::pages.load(std::memory_order_acquire);
-                while(node) {
-                    for (auto& p: node->page) {
-                        _mark(p.load(std::memory_order_acquire));
-                    }
-                    node = node->next;
-                }
+                Heap_roots_allocator::for_each([this](Pointer& p) {
+                    _mark_root(p.load(std::memory_order_acquire));
+                });
+                Heap_roots_allocator::update_pages();
+                Root_blocks::for_each([this](Pointer& p) {
+                    _mark_root(p.load(std::memory_order_acquire));
+                });
             }
 
-            void _mark_childs(void* ptr, const Child_pointers::Vector& offsets) noexcept {
+            void _mark_childs(void* ptr, const Child_pointers::Offsets& offsets, Mark_queue* queue = nullptr) noexcept {
                 for (auto offset : offsets) {
                     auto ap = (Pointer*)((uintptr_t)ptr + offset);
                     auto p = ap->load(std::memory_order_acquire);
                     if ((size_t)p != std::numeric_limits<size_t>::max()) {
-                        _mark(p);
+                        _mark(p, queue);
                     }
                 }
             }
 
-            void _mark_childs(void* ptr, const Child_pointers::Map& map) noexcept {
+            void _mark_childs(void* ptr, const Child_pointers::Map& map, Mark_queue* queue = nullptr) noexcept {
                 for (unsigned index = 0; index < map.size(); ++index) {
                     auto flags = map[index].load(std::memory_order_acquire);
                     if (flags) {
@@ -299,7 +462,7 @@ namespace sgcl {
                                 auto ap = (Pointer*)((uintptr_t)ptr + offset);
                                 auto p = ap->load(std::memory_order_acquire);
                                 if ((size_t)p != std::numeric_limits<size_t>::max()) {
-                                    _mark(p);
+                                    _mark(p, queue);
                                 }
                             }
                         }
@@ -307,15 +470,16 @@ namespace sgcl {
                 }
             }
 
-            void _mark_childs(Child_pointers& pointers, void* ptr) noexcept {
-                if (pointers.offsets) {
-                    _mark_childs(ptr, *pointers.offsets);
+            void _mark_childs(Child_pointers& pointers, void* ptr, Mark_queue* queue = nullptr) noexcept {
+                auto offsets = pointers.offsets.load(std::memory_order_acquire);
+                if (offsets) {
+                    _mark_childs(ptr, *offsets, queue);
                 } else {
-                    _mark_childs(ptr, pointers.map);
+                    _mark_childs(ptr, pointers.map, queue);
                 }
             }
 
-            void _mark_array_childs(void* ptr) noexcept {
+            void _mark_array_childs(void* ptr, Mark_queue* queue = nullptr) noexcept {
                 auto data = (uintptr_t)ptr;
                 auto array = (Array_base*)data;
                 auto metadata = array->metadata.load(std::memory_order_acquire);
@@ -324,21 +488,102 @@ namespace sgcl {
                     _update_child_offsets(pointers);
                     data += sizeof(Array_base);
                     auto object_size = metadata->object_size;
-                    if (pointers.offsets) {
-                        if (pointers.offsets->size()) {
-                            for (size_t c = 0; c < array->count; ++c, data += object_size) {
-                                _mark_childs((void*)data, *pointers.offsets);
+                    auto count = array->count.load(std::memory_order_acquire);
+                    auto offsets = pointers.offsets.load(std::memory_order_acquire);
+                    if (offsets) {
+                        if (offsets->size()) {
+                            for (size_t c = 0; c < count; ++c, data += object_size) {
+                                _mark_childs((void*)data, *offsets, queue);
                             }
                         }
                     } else {
-                        for (size_t c = 0; c < array->count; ++c, data += object_size) {
-                            _mark_childs((void*)data, pointers.map);
+                        for (size_t c = 0; c < count; ++c, data += object_size) {
+                            _mark_childs((void*)data, pointers.map, queue);
                         }
                     }
                 }
             }
 
-            void _mark_reachable() noexcept {
+            static Metadata& _metadata_of(Page* page, unsigned index) noexcept {
+                auto& metadata = page->object_metadata(index);
+                if (page->types) {
+                    _update_child_offsets(metadata.child_pointers);
+                }
+                return metadata;
+            }
+
+            void _visit(const Metadata& metadata, void* ptr) noexcept {
+                _heap_edges = nullptr;
+                const std::type_info* type = &metadata.type_info;
+                auto size = metadata.object_size;
+                if (metadata.is_array) {
+                    auto array = (Array_base*)ptr;
+                    auto array_metadata = array->metadata.load(std::memory_order_acquire);
+                    if (array_metadata) {
+                        type = &array_metadata->type_info;
+                        size = sizeof(Array_base) + array_metadata->object_size * array->count;
+                    }
+                }
+                _heap_visitor->visit({ptr, *type, size, _heap_object_edges.data(), _heap_object_edges.size()});
+                _heap_object_edges.clear();
+            }
+
+            void _mark_object(Page* page, unsigned index) noexcept {
+                auto ptr = page->pointer_of(index);
+                auto& metadata = _metadata_of(page, index);
+                if (_heap_visitor) {
+                    _heap_edges = &_heap_object_edges;
+                }
+                if (metadata.is_array) {
+                    _mark_array_childs(ptr);
+                } else {
+                    _mark_childs(metadata.child_pointers, ptr);
+                }
+                if (_heap_visitor) {
+                    _visit(metadata, ptr);
+                }
+                if (_live_objects_request) {
+                    _live_objects.emplace_back(ptr);
+                }
+            }
+
+#if SGCL_MARK_STACK
+            // returns false if the deadline stopped marking, the pointers left are kept in the stack
+            template<class D>
+            bool _drain_mark_stack(D& deadline) noexcept {
+                return _mark_stack.drain([this](Page* page, unsigned index) {
+                    auto& flag = page->flags()[Page::flag_index_of(index)];
+                    auto mask = Page::flag_mask_of(index);
+                    auto marked = flag.marked.load(std::memory_order_relaxed);
+                    if (flag.registered & ~marked & mask) {
+                        if constexpr(Phase_tracer::Enabled) {
+                            ++_traced_objects;
+                        }
+                        flag.marked.store(marked | mask, std::memory_order_relaxed);
+                        _update_child_offsets(page->metadata->child_pointers);
+                        _mark_object(page, index);
+                    }
+                }, deadline);
+            }
+#endif
+
+            // returns false if the deadline stopped marking, the pages left are kept in the reachable list
+            template<class D = No_deadline>
+            bool _mark_reachable(D&& deadline = {}) noexcept {
+#if SGCL_MARK_STACK
+                // the roots are marked on pages, the childs of the objects are pushed to the stack
+                _mark_stack_active = true;
+                bool done = _mark_reachable_pages(deadline);
+                _mark_stack_active = false;
+                return done;
+            }
+
+            template<class D>
+            bool _mark_reachable_pages(D& deadline) noexcept {
+                if (!_drain_mark_stack(deadline)) {
+                    return false;
+                }
+#endif
                 auto page = _reachable_pages;
                 _reachable_pages = nullptr;
                 while(page) {
@@ -350,35 +595,191 @@ namespace sgcl {
                         marked = false;
                         for (unsigned i = 0; i < count; ++i) {
                             auto& flag = flags[i];
-                            while (flag.reachable) {
-                                for (unsigned j = 0; j < Page::FlagBitCount; ++j) {
-                                    auto mask = Page::Flag(1) << j;
-                                    if (flag.reachable & mask) {
-                                        flag.marked |= mask;
-                                        auto index = i * Page::FlagBitCount + j;
-                                        auto ptr = page->pointer_of(index);
-                                        if (page->metadata->is_array) {
-                                            _mark_array_childs(ptr);
-                                        } else {
-                                            _mark_childs(page->metadata->child_pointers, ptr);
-                                        }
-                                        if (_live_objects_request) {
-                                            _live_objects.emplace_back(ptr);
-                                        }
-                                        marked = true;
-                                    }
+                            auto reachable = flag.reachable.load(std::memory_order_relaxed);
+                            while (reachable) {
+                                flag.reachable.store(0, std::memory_order_relaxed);
+                                // objects marked from the stack keep their reachable bits
+                                auto marked_bits = flag.marked.load(std::memory_order_relaxed);
+                                reachable &= ~marked_bits;
+                                if constexpr(Phase_tracer::Enabled) {
+                                    _traced_objects += Popcount(reachable);
                                 }
-                                flag.reachable &= ~flag.marked;
+                                flag.marked.store(marked_bits | reachable, std::memory_order_relaxed);
+                                For_each_bit(reachable, [&](unsigned j) {
+                                    _mark_object(page, i * Page::FlagBitCount + j);
+                                });
+                                marked = true;
+                                reachable = flag.reachable.load(std::memory_order_relaxed);
                             }
                         }
                     } while(marked);
-                    page->reachable = false;
+                    page->reachable.store(false, std::memory_order_relaxed);
+                    if constexpr(Phase_tracer::Enabled) {
+                        ++_traced_pages;
+                    }
                     page = page->next_reachable;
+#if SGCL_MARK_STACK
+                    if (!_drain_mark_stack(deadline)) {
+                        if (page) {
+                            auto last = page;
+                            while(last->next_reachable) {
+                                last = last->next_reachable;
+                            }
+                            last->next_reachable = _reachable_pages;
+                            _reachable_pages = page;
+                        }
+                        return false;
+                    }
+#endif
                     if (!page) {
                         page = _reachable_pages;
                         _reachable_pages = nullptr;
                     }
+                    if (page && deadline()) {
+                        auto last = page;
+                        while(last->next_reachable) {
+                            last = last->next_reachable;
+                        }
+                        last->next_reachable = _reachable_pages;
+                        _reachable_pages = page;
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            void _mark_page(Page* page, Mark_queue& queue) noexcept {
+                // cleared before the flags are taken, so a bit set by another marker
+                // either is taken below or makes that marker push the page again
+                page->reachable.store(false);
+                _update_child_offsets(page->metadata->child_pointers);
+                auto flags = page->flags();
+                auto count = page->flags_count();
+                for (unsigned i = 0; i < count; ++i) {
+                    auto& flag = flags[i];
+                    auto reachable = flag.reachable.exchange(0);
+                    while (reachable) {
+                        auto marked = reachable & ~flag.marked.fetch_or(reachable, std::memory_order_acq_rel);
+                        if constexpr(Phase_tracer::Enabled) {
+                            _traced_marked.fetch_add(Popcount(marked), std::memory_order_relaxed);
+                        }
+                        For_each_bit(marked, [&](unsigned j) {
+                            auto index = i * Page::FlagBitCount + j;
+                            auto ptr = page->pointer_of(index);
+                            auto& metadata = _metadata_of(page, index);
+                            if (metadata.is_array) {
+                                _mark_array_childs(ptr, &queue);
+                            } else {
+                                _mark_childs(metadata.child_pointers, ptr, &queue);
+                            }
+                        });
+                        reachable = flag.reachable.exchange(0);
+                    }
+                }
+            }
+
+            Page* _take_page(unsigned index) noexcept {
+                auto page = _mark_queues[index].pop();
+                for (unsigned i = 1; !page && i < _mark_queues.size(); ++i) {
+                    page = _mark_queues[(index + i) % _mark_queues.size()].steal();
+                }
+                return page;
+            }
+
+            void _wake_markers(bool all) {
+                {
+                    std::lock_guard<std::mutex> lock(_idle_mutex);
+                    ++_idle_signal;
+                }
+                if (all) {
+                    _idle_cv.notify_all();
+                } else {
+                    _idle_cv.notify_one();
+                }
+            }
+
+            // a marker without pages parks while other markers still mark pages, a page is pushed
+            // before the count of idle markers is read, and the count is raised before the queues
+            // are scanned again, so either the scan finds the page or the pusher wakes a marker
+            void _mark_worker(unsigned index) noexcept {
+                auto& queue = _mark_queues[index];
+                for (;;) {
+                    auto page = _take_page(index);
+                    if (!page && _pending_pages.load(std::memory_order_acquire)) {
+                        unsigned signal;
+                        {
+                            std::lock_guard<std::mutex> lock(_idle_mutex);
+                            signal = _idle_signal;
+                        }
+                        _idle_markers.fetch_add(1, std::memory_order_seq_cst);
+                        page = _take_page(index);
+                        if (!page) {
+                            std::unique_lock<std::mutex> lock(_idle_mutex);
+                            _idle_cv.wait(lock, [&]{
+                                return _idle_signal != signal || !_pending_pages.load(std::memory_order_acquire);
+                            });
+                        }
+                        _idle_markers.fetch_sub(1, std::memory_order_relaxed);
+                    }
+                    if (page) {
+                        _mark_page(page, queue);
+                        if (_pending_pages.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                            _wake_markers(true);
+                        }
+                    } else if (!_pending_pages.load(std::memory_order_acquire)) {
+                        break;
+                    }
+                }
+            }
+
+            void _marker_loop(unsigned index) noexcept {
+                unsigned phase = 0;
+                for (;;) {
+                    {
+                        std::unique_lock<std::mutex> lock(_marking_mutex);
+                        _marking_cv.wait(lock, [&]{
+                            return _marking_phase != phase || _marking_stop;
+                        });
+                        if (_marking_stop) {
+                            return;
+                        }
+                        phase = _marking_phase;
+                    }
+                    _mark_worker(index);
+                    std::lock_guard<std::mutex> lock(_marking_mutex);
+                    if (!--_active_markers) {
+                        _marking_done_cv.notify_one();
+                    }
+                }
+            }
+
+            void _mark_reachable_parallel() {
+                unsigned index = 0;
+                auto page = _reachable_pages;
+                _reachable_pages = nullptr;
+                while(page) {
+                    auto next = page->next_reachable;
+                    _pending_pages.fetch_add(1, std::memory_order_relaxed);
+                    _mark_queues[index++ % _mark_queues.size()].push(page);
+                    page = next;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(_marking_mutex);
+                    if (!_markers_started) {
+                        _markers_started = true;
+                        for (unsigned i = 1; i < _mark_queues.size(); ++i) {
+                            std::thread([this, i]{_marker_loop(i);}).detach();
+                        }
+                    }
+                    _active_markers = SGCL_MARKING_THREADS;
+                    ++_marking_phase;
                 }
+                _marking_cv.notify_all();
+                _mark_worker(0);
+                std::unique_lock<std::mutex> lock(_marking_mutex);
+                _marking_done_cv.wait(lock, [this]{
+                    return _active_markers == 0;
+                });
             }
 
             template<bool All>
@@ -393,25 +794,20 @@ namespace sgcl {
                     auto count = page->flags_count();
                     for (unsigned i = 0; i < count; ++i) {
                         auto& flag = flags[i];
-                        auto unreachable = flag.registered & ~flag.marked;
-                        if (unreachable) {
-                            for (unsigned j = 0; j < Page::FlagBitCount; ++j) {
-                                auto mask = Page::Flag(1) << j;
-                                if (unreachable & mask) {
-                                    auto index = i * Page::FlagBitCount + j;
-                                    auto state = states[index].load(std::memory_order_relaxed);
-                                    if (state >= State::Reachable && state <= State::UniqueLock) {
-                                        flag.reachable |= mask;
-                                        reachable_page = true;
-                                    } else if constexpr(All) {
-                                        unreachable_page = true;
-                                    }
-                                }
+                        auto unreachable = flag.registered & ~flag.marked.load(std::memory_order_relaxed);
+                        For_each_bit(unreachable, [&](unsigned j) {
+                            auto index = i * Page::FlagBitCount + j;
+                            auto state = states[index].load(std::memory_order_relaxed);
+                            if (state >= State::Reachable && state <= State::UniqueLock) {
+                                flag.reachable.store(flag.reachable.load(std::memory_order_relaxed) | (Page::Flag(1) << j), std::memory_order_relaxed);
+                                reachable_page = true;
+                            } else if constexpr(All) {
+                                unreachable_page = true;
                             }
-                        }
+                        });
                     }
-                    if (reachable_page && !page->reachable) {
-                        page->reachable = true;
+                    if (reachable_page && !page->reachable.load(std::memory_order_relaxed)) {
+                        page->reachable.store(true, std::memory_order_relaxed);
                         page->next_reachable = _reachable_pages;
                         _reachable_pages = page;
                     }
@@ -428,7 +824,7 @@ namespace sgcl {
                 }
             }
 
-            inline static void _clear_childs(void* ptr, const Child_pointers::Vector& offsets) noexcept {
+            inline static void _clear_childs(void* ptr, const Child_pointers::Offsets& offsets) noexcept {
                 for (auto offset : offsets) {
                     auto p = (Pointer*)((uintptr_t)ptr + offset);
                     p->store(nullptr, std::memory_order_relaxed);
@@ -452,8 +848,9 @@ namespace sgcl {
             }
 
             inline static void _clear_childs(Child_pointers& childs, void* ptr) noexcept {
-                if (childs.offsets) {
-                    _clear_childs(ptr, *childs.offsets);
+                auto offsets = childs.offsets.load(std::memory_order_acquire);
+                if (offsets) {
+                    _clear_childs(ptr, *offsets);
                 } else {
                     _clear_childs(ptr, childs.map);
                 }
@@ -468,14 +865,16 @@ namespace sgcl {
                     _update_child_offsets(pointers);
                     data += sizeof(Array_base);
                     auto object_size = metadata->object_size;
-                    if (pointers.offsets) {
-                        if (pointers.offsets->size()) {
-                            for (size_t c = 0; c < array->count; ++c, data += object_size) {
-                                _clear_childs((void*)data, *pointers.offsets);
+                    auto count = array->count.load(std::memory_order_acquire);
+                    auto offsets = pointers.offsets.load(std::memory_order_acquire);
+                    if (offsets) {
+                        if (offsets->size()) {
+                            for (size_t c = 0; c < count; ++c, data += object_size) {
+                                _clear_childs((void*)data, *offsets);
                             }
                         }
                     } else {
-                        for (size_t c = 0; c < array->count; ++c, data += object_size) {
+                        for (size_t c = 0; c < count; ++c, data += object_size) {
                             _clear_childs((void*)data, pointers.map);
                         }
                     }
@@ -483,10 +882,11 @@ namespace sgcl {
             }
 
             inline static void _destroy(Page* page, void* ptr) noexcept {
-                auto destroy = page->metadata->destroy;
+                auto& metadata = page->object_metadata(page->index_of(ptr));
+                auto destroy = metadata.destroy;
                 if (destroy) {
-                    if (!page->metadata->is_array) {
-                        _clear_childs(page->metadata->child_pointers, ptr);
+                    if (!metadata.is_array) {
+                        _clear_childs(metadata.child_pointers, ptr);
                         destroy(ptr);
                     } else {
                         auto array = (Array_base*)ptr;
@@ -499,83 +899,411 @@ namespace sgcl {
                 }
             }
 
-            Counter _remove_garbage() noexcept {
-                Counter released;
+            // the user metadata of an array is the metadata of its elements
+            static metadata* _user_metadata(Metadata& metadata, void* ptr) noexcept {
+                auto user_metadata = metadata.user_metadata;
+                if (metadata.is_array) {
+                    auto array_metadata = ((Array_base*)ptr)->metadata.load(std::memory_order_acquire);
+                    user_metadata = array_metadata ? array_metadata->user_metadata : nullptr;
+                }
+                return user_metadata;
+            }
+
+            static bool _is_deferred(Metadata& metadata, void* ptr) noexcept {
+                auto user_metadata = _user_metadata(metadata, ptr);
+                return user_metadata && user_metadata->deferred_destruction;
+            }
+
+            // returns false if the destructor is skipped by the shutdown mode
+            bool _is_finalized(Metadata& metadata, void* ptr) const noexcept {
+                if (!_terminating.load(std::memory_order_acquire) || _shutdown_mode == shutdown_mode::finalize) {
+                    return true;
+                }
+                auto user_metadata = _user_metadata(metadata, ptr);
+                return _shutdown_mode == shutdown_mode::opted && user_metadata && user_metadata->finalize_on_shutdown;
+            }
+
+            // adds to _released, returns false if the deadline stopped sweeping, the pages left stay unreachable
+            template<class D = No_deadline>
+            bool _remove_garbage(D&& deadline = {}) {
+                auto& released = _released;
+                auto mode = _sweeper.mode();
+                Sweeper::Batch garbage;
                 auto page = _unreachable_pages;
                 _unreachable_pages = nullptr;
                 while(page) {
+                    if (page->arena == Page::Arena::Ended && _free_arena_page(page, mode)) {
+                        page->unreachable = false;
+                        page = page->next_unreachable;
+                        if (page && deadline()) {
+                            _unreachable_pages = page;
+                            break;
+                        }
+                        continue;
+                    }
                     _update_child_offsets(page->metadata->child_pointers);
                     auto states = page->states();
                     auto data = page->data;
                     auto object_size = page->metadata->object_size;
                     auto flags = page->flags();
                     auto count = page->flags_count();
+#if SGCL_PROFILER
+                    auto sampled = page->sampled.load(std::memory_order_relaxed);
+#endif
+                    bool swept = false;
                     for (unsigned i = 0; i < count; ++i) {
                         auto& flag = flags[i];
-                        auto unreachable = flag.registered & ~flag.marked;
+                        auto unreachable = flag.registered & ~flag.marked.load(std::memory_order_relaxed);
                         if (unreachable) {
-                            for (unsigned j = 0; j < Page::FlagBitCount; ++j) {
-                                auto mask = Page::Flag(1) << j;
-                                if (unreachable & mask) {
-                                    auto index = i * Page::FlagBitCount + j;
-                                    auto state = states[index].load(std::memory_order_relaxed);
-                                    assert(state < State::Reachable || state > State::UniqueLock);
-                                    if (state != State::BadAlloc) {
-                                        if (state != State::Destroyed) {
-                                            _destroy(page, page->pointer_of(index));
-                                        }
-                                        released.count++;
-                                        if (!page->metadata->is_array || object_size != sizeof(Array<PageDataSize>)) {
-                                            released.size += object_size;
-                                        } else {
-                                            auto array = (Array_base*)data;
-                                            auto metadata = array->metadata.load(std::memory_order_acquire);
-                                            released.size += sizeof(Array_base) + metadata->object_size * array->count;
+                            For_each_bit(unreachable, [&](unsigned j) {
+                                auto index = i * Page::FlagBitCount + j;
+                                auto state = states[index].load(std::memory_order_relaxed);
+                                assert(state < State::Reachable || state > State::UniqueLock);
+                                auto new_state = State::Unused;
+                                if (state != State::BadAlloc) {
+                                    if (state != State::Destroyed) {
+                                        auto ptr = page->pointer_of(index);
+                                        auto& metadata = page->object_metadata(index);
+                                        if (!_is_finalized(metadata, ptr)) {
+                                            // the destructor is skipped at shutdown, see shutdown_mode
+                                        } else if (mode == Sweeper::Mode::None || (mode == Sweeper::Mode::Opted && !_is_deferred(metadata, ptr))) {
+                                            _destroy(page, ptr);
+                                        } else if (metadata.destroy) {
+                                            // the slot stays reserved until a sweeper runs the destructor
+                                            new_state = State::Reserved;
+                                            garbage.emplace_back(ptr);
                                         }
                                     }
-                                    states[index].store(State::Unused, std::memory_order_release);
+                                    released.count++;
+#if SGCL_PROFILER
+                                    if (sampled) {
+                                        Profiler::released(page, page->pointer_of(index));
+                                    }
+#endif
+                                    if (!page->metadata->is_array || object_size != sizeof(Array<PageDataSize>)) {
+                                        released.size += object_size;
+                                    } else {
+                                        auto array = (Array_base*)data;
+                                        auto metadata = array->metadata.load(std::memory_order_acquire);
+                                        released.size += sizeof(Array_base) + metadata->object_size * array->count;
+                                    }
                                 }
-                            }
-                            flag.registered &= flag.marked;
+                                if (new_state == State::Unused) {
+                                    page->clear(index);
+                                }
+                                states[index].store(new_state, std::memory_order_release);
+                                // the batch is pushed after the state is stored, a sweeper could make the slot
+                                // unused before the store and a new object in it would be left reserved
+                                if (garbage.size() == Sweeper::BatchSize) {
+                                    _sweeper.push(std::move(garbage));
+                                    garbage = {};
+                                }
+                            });
+                            flag.registered &= flag.marked.load(std::memory_order_relaxed);
+                            swept = true;
                         }
                     }
+                    if (swept) {
+                        _add_release_candidate(page);
+                    }
                     page->unreachable = false;
+                    if constexpr(Phase_tracer::Enabled) {
+                        ++_traced_pages;
+                    }
                     page = page->next_unreachable;
+                    if (page && deadline()) {
+                        _unreachable_pages = page;
+                        break;
+                    }
+                }
+                if (!garbage.empty()) {
+                    _sweeper.push(std::move(garbage));
+                }
+                return !_unreachable_pages;
+            }
+
+            // the objects of ended arena scopes are allocated before the cycle, so they are registered;
+            // the page is freed at once if none of them is marked and no destructor is left to a sweeper
+            bool _free_arena_page(Page* page, Sweeper::Mode mode) {
+                auto states = page->states();
+                auto flags = page->flags();
+                auto count = page->flags_count();
+                auto object_count = page->metadata->object_count;
+                if (page->metadata->is_array) {
+                    return false;
+                }
+#if SGCL_PROFILER
+                if (page->sampled.load(std::memory_order_relaxed)) {
+                    return false;
+                }
+#endif
+                if ((mode != Sweeper::Mode::None && (page->types || page->metadata->destroy)) || State_scan::any_of(states, object_count, State::Reserved)) {
+                    return false;
+                }
+                for (unsigned i = 0; i < count; ++i) {
+                    if (flags[i].registered & flags[i].marked.load(std::memory_order_relaxed)) {
+                        return false;
+                    }
+                }
+                int64_t released = 0;
+                if (page->types || page->metadata->destroy) {
+                    for (unsigned i = 0; i < count; ++i) {
+                        For_each_bit(flags[i].registered, [&](unsigned j) {
+                            auto index = i * Page::FlagBitCount + j;
+                            auto state = states[index].load(std::memory_order_relaxed);
+                            if (state != State::BadAlloc) {
+                                auto ptr = page->pointer_of(index);
+                                if (state != State::Destroyed && _is_finalized(page->object_metadata(index), ptr)) {
+                                    _destroy(page, ptr);
+                                }
+                                ++released;
+                            }
+                        });
+                    }
+                } else {
+                    for (unsigned i = 0; i < count; ++i) {
+                        released += Popcount(flags[i].registered);
+                    }
+                    State_scan::for_each(states, object_count, State::BadAlloc, State::BadAlloc, [&](unsigned i) {
+                        released -= (flags[Page::flag_index_of(i)].registered & Page::flag_mask_of(i)) != 0;
+                    });
+                }
+                for (unsigned i = 0; i < count; ++i) {
+                    flags[i].registered = 0;
+                }
+                _released.count += released;
+                _released.size += released * page->metadata->object_size;
+                _free_arena_data(page);
+                return true;
+            }
+
+            // the data goes back to the block allocator after the sweep, the remembered objects
+            // still find their page header until then; the header is deleted with the unused pages
+            void _free_arena_data(Page* page) {
+                page->is_used = false;
+                _arena_data.emplace_back((Data_page*)(page->data - sizeof(void*)), page->block);
+            }
+
+            void _take_arena_pages() {
+                auto page = Thread::arena_pages.exchange(nullptr, std::memory_order_acquire);
+                if (page) {
+                    auto& batch = _arena_batches.emplace_back();
+                    while(page) {
+                        page->arena = Page::Arena::Ended;
+                        batch.pages.emplace_back(page);
+                        page = page->next_arena;
+                    }
+                }
+            }
+
+            static void _take_pool_pages(Page_pool* pool) {
+                auto page = pool->new_pages.exchange(nullptr, std::memory_order_acquire);
+                while(page) {
+                    pool->pages.emplace_back(page);
+                    page = page->next_arena;
+                }
+            }
+
+            // the pages of an ended pool are freed like the pages of ended arena scopes,
+            // its buffered pages are shared once the arena batch expires
+            void _take_pools() {
+                auto pool = Page_pool::created_pools.exchange(nullptr, std::memory_order_acquire);
+                while(pool) {
+                    _pools.emplace_back(pool);
+                    pool = pool->next;
+                }
+                size_t count = 0;
+                for (auto pool : _pools) {
+                    bool ended = pool->ended.load(std::memory_order_acquire);
+                    _take_pool_pages(pool);
+                    if (!ended) {
+                        _pools[count++] = pool;
+                        continue;
+                    }
+                    pool->for_each_buffer([](Pool_buffer& buffer) {
+                        for (auto page = buffer.pages.top(); page; page = page->next_empty) {
+                            page->on_empty_list.store(false, std::memory_order_relaxed);
+                        }
+                    });
+                    if (!pool->pages.empty()) {
+                        for (auto page : pool->pages) {
+                            page->arena = Page::Arena::Ended;
+                            page->pool_buffer = nullptr;
+                        }
+                        auto& batch = _arena_batches.emplace_back();
+                        batch.pages = std::move(pool->pages);
+                    }
+                    delete pool;
+                }
+                _pools.resize(count);
+            }
+
+            // the new objects are reachable by their states in the first cycle, so the pages wait
+            // until the states of dead objects are aged; then the pages left are shared
+            void _release_arena_pages() {
+                size_t count = 0;
+                for (auto& batch : _arena_batches) {
+                    ++batch.cycles;
+                    bool expired = batch.cycles >= ArenaCycles && batch.timer.duration() >= DeletionDelayMsec;
+                    size_t used = 0;
+                    for (auto page : batch.pages) {
+                        if (!page->is_used) {
+                            continue;
+                        }
+                        // the objects of the scope are registered in the first cycle
+                        if (!page->registered) {
+                            _free_arena_data(page);
+                            // a page still on the dirty list is deleted by _update_pages()
+                            if (!page->dirty.load(std::memory_order_acquire)) {
+                                Page::destroy(page);
+                            }
+                        } else if (expired) {
+                            page->arena = Page::Arena::None;
+                            _add_release_candidate(page);
+                        } else {
+                            batch.pages[used++] = page;
+                        }
+                    }
+                    batch.pages.resize(used);
+                    if (used) {
+                        // a self move would empty the pages of a batch that stays in place
+                        if (&_arena_batches[count] != &batch) {
+                            _arena_batches[count] = std::move(batch);
+                        }
+                        ++count;
+                    }
+                }
+                _arena_batches.resize(count);
+                if (!_arena_data.empty()) {
+                    Data_page* pages = nullptr;
+                    for (auto [data, block] : _arena_data) {
+                        data->block = block;
+                        data->next = pages;
+                        pages = data;
+                    }
+                    Block_allocator::free(pages);
+                    _arena_data.clear();
+                }
+            }
+
+            static size_t _data_extent(Page* page) noexcept {
+                if (page->block) {
+                    return page->metadata->object_count * page->metadata->object_size;
+                }
+                if (page->metadata->is_array) {
+                    auto array = (Array_base*)page->data;
+                    auto metadata = array->metadata.load(std::memory_order_acquire);
+                    return sizeof(Array_base) + (metadata ? metadata->object_size * array->count : 0);
+                }
+                return page->metadata->object_size;
+            }
+
+            // the pages emptied by the compactor are released with the unused pages
+            size_t _compact(double occupancy) {
+                _sweeper.wait();
+#if SGCL_GENERATIONAL
+                _take_remembered_slots();
+#endif
+                auto moved = _compactor.compact(_registered_pages, occupancy);
+                if (moved) {
+                    for (auto page = _registered_pages; page; page = page->next_registered) {
+                        _add_release_candidate(page);
+                    }
+                }
+#if SGCL_GENERATIONAL
+                if (moved) {
+                    for (auto& ptr : _remembered) {
+                        ptr = _compactor.forward(ptr);
+                    }
+                    for (auto& slot : _remembered_slots) {
+                        slot = _compactor.forward_slot(slot);
+                    }
+                }
+#endif
+                return moved;
+            }
+
+            // pages get unused places only when swept, when their arena expires, when compacted or
+            // when an allocator with reserved places ends, which dirties the page
+            void _add_release_candidate(Page* page) {
+                if (!page->release_candidate) {
+                    page->release_candidate = true;
+                    _release_candidates.emplace_back(page);
                 }
-                return released;
             }
 
+            // only the candidates are scanned for unused places, a candidate with reserved places
+            // stays, its places may be released later by an allocator or a sweeper; the walk over
+            // all registered pages remains for unlinking freed pages, counting heap bytes and
+            // clearing the flags for the next cycle
             void _release_unused_pages() {
                 Metadata* metadata = nullptr;
-                auto page = _registered_pages;
-                while(page) {
+                Pool_buffer* buffers = nullptr;
+                size_t candidates = 0;
+                for (auto page : _release_candidates) {
+                    if (!page->is_used || (page->arena != Page::Arena::None && page->arena != Page::Arena::Pool)) {
+                        page->release_candidate = false;
+                        continue;
+                    }
                     if (!page->on_empty_list.load(std::memory_order_acquire)) {
-                        auto states = page->states();
-                        auto count = page->metadata->object_count;
-                        for (unsigned i = 0; i < count; ++i) {
-                            auto state = states[i].load(std::memory_order_relaxed);
-                            if (state == State::Unused) {
-                                page->on_empty_list.store(true, std::memory_order_relaxed);
+                        if (State_scan::any_of(page->states(), page->metadata->object_count, State::Unused)) {
+                            page->on_empty_list.store(true, std::memory_order_relaxed);
+                            if (page->arena == Page::Arena::Pool) {
+                                auto buffer = page->pool_buffer;
+                                if (!buffer->empty_page) {
+                                    buffer->next = buffers;
+                                    buffers = buffer;
+                                }
+                                page->next_empty = buffer->empty_page;
+                                buffer->empty_page = page;
+                            } else {
                                 if (!page->metadata->empty_page) {
                                     page->metadata->next = metadata;
                                     metadata = page->metadata;
                                 }
                                 page->next_empty = page->metadata->empty_page;
                                 page->metadata->empty_page = page;
-                                break;
                             }
                         }
                     }
-                    page = page->next_registered;
+                    if (State_scan::any_of(page->states(), page->metadata->object_count, State::Reserved)) {
+                        _release_candidates[candidates++] = page;
+                    } else {
+                        page->release_candidate = false;
+                    }
                 }
+                _release_candidates.resize(candidates);
                 while(metadata) {
                     metadata->free(metadata->empty_page);
                     metadata->empty_page = nullptr;
                     metadata = metadata->next;
                 }
+                while(buffers) {
+                    Small_object_allocator_base::free(buffers->empty_page, buffers->pages);
+                    buffers->empty_page = nullptr;
+                    buffers = buffers->next;
+                }
+                // the freed pages are deleted below
+                candidates = 0;
+                for (auto page : _release_candidates) {
+                    if (page->is_used) {
+                        _release_candidates[candidates++] = page;
+                    } else {
+                        page->release_candidate = false;
+                    }
+                }
+                _release_candidates.resize(candidates);
+                for (auto pool : _pools) {
+                    _take_pool_pages(pool);
+                    pool->pages.erase(std::remove_if(pool->pages.begin(), pool->pages.end(), [](Page* page) {
+                        return !page->is_used;
+                    }), pool->pages.end());
+                }
 
+                _cycle_stats.heap_bytes = 0;
+                _traced_pages = 0;
                 Page* prev = nullptr;
-                page = _registered_pages;
+                auto page = _registered_pages;
                 while(page) {
                     auto next = page->next_registered;
                     if (!page->is_used) {
@@ -584,115 +1312,655 @@ namespace sgcl {
                         } else {
                             prev->next_registered = next;
                         }
+#if SGCL_GENERATIONAL
+                        // the data may already belong to a new page
+                        auto heap_page = _heap_pages.find(page->data);
+                        if (heap_page != _heap_pages.end() && heap_page->second == page) {
+                            _heap_pages.erase(heap_page);
+                        }
+#endif
+                        // a page still on the dirty list is deleted by _update_pages()
+                        if (!page->dirty.load(std::memory_order_acquire)) {
+                            Page::destroy(page);
+                        }
                     } else {
+                        page->clear_flags();
+                        _cycle_stats.heap_bytes += page->block ? PageSize : sizeof(uintptr_t) + _data_extent(page);
+                        if constexpr(Phase_tracer::Enabled) {
+                            ++_traced_pages;
+                        }
                         prev = page;
                     }
                     page = next;
                 }
             }
 
-            void _main_loop() noexcept {
-                static constexpr int64_t MinLiveSize = PageSize;
-                static constexpr int64_t MinLiveCount = MinLiveSize / sizeof(uintptr_t) * 2;
-#if SGCL_LOG_PRINT_LEVEL
-                std::cout << "[sgcl] start collector id: " << std::this_thread::get_id() << std::endl;
-#endif
-                using namespace std::chrono_literals;
-                int finalization_counter = 5;
-                Counter allocated;
-                Counter removed;
-                Counter last3_removed[3];
-                do {
-#if SGCL_LOG_PRINT_LEVEL >= 2
-                    auto start = std::chrono::high_resolution_clock::now();
-#endif
-                    _check_threads();
-                    _update_states();
-                    _register_objects();
-                    _mark_stack_roots();
-                    _mark_heap_roots();
-                    do {
-                        _mark_reachable();
-                        if (_unreachable_pages) {
-                            _mark_updated<false>();
+#if SGCL_GENERATIONAL
+            void _take_remembered_slots() {
+                auto thread = Thread::threads_data.load(std::memory_order_acquire);
+                while(thread) {
+                    thread->lock_remembered();
+                    _remembered_slots.insert(_remembered_slots.end(), thread->remembered_slots.begin(), thread->remembered_slots.end());
+                    thread->remembered_slots.clear();
+                    thread->unlock_remembered();
+                    thread = thread->next;
+                }
+            }
+
+            // tracked pointers can also be root slots, and slots of large objects can lie
+            // past the first page where Page::page_of() does not work
+            Page* _owner_page(const void* slot) const noexcept {
+                auto it = _heap_pages.upper_bound((uintptr_t)slot);
+                if (it != _heap_pages.begin()) {
+                    auto page = std::prev(it)->second;
+                    if ((uintptr_t)slot < page->data + _data_extent(page)) {
+                        return page;
+                    }
+                }
+                return nullptr;
+            }
+
+            // the owners of slots written since the last cycle are remembered if they are old,
+            // the slots are taken before _update_pages() so their owners are already registered
+            void _update_remembered() {
+                for (auto slot : _remembered_slots) {
+                    auto page = _owner_page(slot);
+                    if (!page) {
+                        continue;
+                    }
+                    // a slot of a large object can lie beyond the size of the page type
+                    auto index = page->block ? page->index_of(slot) : 0;
+                    auto& flag = page->flags()[Page::flag_index_of(index)];
+                    auto mask = Page::flag_mask_of(index);
+                    if (flag.old.load(std::memory_order_relaxed) & ~flag.remembered & mask) {
+                        flag.remembered |= mask;
+                        _remembered.emplace_back(page->pointer_of(index));
+                    }
+                }
+                _remembered_slots.clear();
+            }
+
+            void _mark_remembered() noexcept {
+                for (auto ptr : _remembered) {
+                    auto page = Page::page_of(ptr);
+                    _update_child_offsets(page->metadata->child_pointers);
+                    auto& metadata = _metadata_of(page, page->index_of(ptr));
+                    if (metadata.is_array) {
+                        _mark_array_childs(ptr);
+                    } else {
+                        _mark_childs(metadata.child_pointers, ptr);
+                    }
+                }
+            }
+
+            static bool _is_young(const void* p) noexcept {
+                return p && (size_t)p != std::numeric_limits<size_t>::max() && Page::is_young(p);
+            }
+
+            static bool _has_young_childs(void* ptr, const Child_pointers::Offsets& offsets) noexcept {
+                for (auto offset : offsets) {
+                    auto p = (Pointer*)((uintptr_t)ptr + offset);
+                    if (_is_young(p->load(std::memory_order_acquire))) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            static bool _has_young_childs(void* ptr, const Child_pointers::Map& map) noexcept {
+                for (unsigned index = 0; index < map.size(); ++index) {
+                    auto flags = map[index].load(std::memory_order_acquire);
+                    for (unsigned i = 0; flags && i < 8; ++ i) {
+                        if (flags & (1 << i)) {
+                            auto p = (Pointer*)((uintptr_t)ptr + (index * 8 + i) * sizeof(Pointer));
+                            if (_is_young(p->load(std::memory_order_acquire))) {
+                                return true;
+                            }
+                        }
+                    }
+                }
+                return false;
+            }
+
+            static bool _has_young_childs(Child_pointers& pointers, void* ptr) noexcept {
+                auto offsets = pointers.offsets.load(std::memory_order_acquire);
+                return offsets ? _has_young_childs(ptr, *offsets) : _has_young_childs(ptr, pointers.map);
+            }
+
+            static bool _has_young_childs(Page* page, void* ptr) noexcept {
+                auto& metadata = page->object_metadata(page->index_of(ptr));
+                if (!metadata.is_array) {
+                    return _has_young_childs(metadata.child_pointers, ptr);
+                }
+                auto array = (Array_base*)ptr;
+                auto array_metadata = array->metadata.load(std::memory_order_acquire);
+                if (array_metadata) {
+                    auto data = (uintptr_t)ptr + sizeof(Array_base);
+                    auto count = array->count.load(std::memory_order_acquire);
+                    for (size_t c = 0; c < count; ++c, data += array_metadata->object_size) {
+                        if (_has_young_childs(array_metadata->child_pointers, (void*)data)) {
+                            return true;
+                        }
+                    }
+                }
+                return false;
+            }
+
+            // objects marked in two cycles in a row become old, an object stays remembered
+            // as long as it points to young objects
+            void _update_generations() {
+                for (auto page = _registered_pages; page; page = page->next_registered) {
+                    auto flags = page->flags();
+                    auto count = page->flags_count();
+                    for (unsigned i = 0; i < count; ++i) {
+                        auto& flag = flags[i];
+                        auto old = flag.old.load(std::memory_order_relaxed) & flag.registered;
+                        auto young = flag.marked.load(std::memory_order_relaxed) & flag.registered & ~old;
+                        auto promoted = young & flag.survived;
+                        flag.survived = young & ~promoted;
+                        flag.old.store(old | promoted, std::memory_order_relaxed);
+                        flag.remembered &= flag.registered;
+                        For_each_bit(promoted & ~flag.remembered, [&](unsigned j) {
+                            _remembered.emplace_back(page->pointer_of(i * Page::FlagBitCount + j));
+                        });
+                        flag.remembered |= promoted;
+                    }
+                }
+                size_t count = 0;
+                for (auto ptr : _remembered) {
+                    auto page = Page::page_of(ptr);
+                    auto index = page->index_of(ptr);
+                    auto& flag = page->flags()[Page::flag_index_of(index)];
+                    auto mask = Page::flag_mask_of(index);
+                    if (flag.remembered & mask) {
+                        if (_has_young_childs(page, ptr)) {
+                            _remembered[count++] = ptr;
                         } else {
-                            _mark_updated<true>();
-                        }
-                    } while(_reachable_pages);
-                    Counter last_removed = _remove_garbage();
-                    last3_removed[0] = last3_removed[1];
-                    last3_removed[1] = last3_removed[2];
-                    last3_removed[2] = last_removed;
-                    Counter max_removed = max(last3_removed[0], max(last3_removed[1], last3_removed[2]));
-                    _release_unused_pages();
-                    Counter last_allocated = _alloc_counter() - allocated;
-                    Counter live = allocated + last_allocated - (removed + last_removed);
-                    _live_objects_number.store(live.count, std::memory_order_release);
-                    assert(live.count >= 0 && live.size >= 0);
-#if SGCL_LOG_PRINT_LEVEL >= 2
-                    auto end = std::chrono::high_resolution_clock::now();
-                    std::cout << "[sgcl] live objects: " << live.count << ", allocated: " << last_allocated.count << ", destroyed: " << last_removed.count << ", time: "
-                              << std::chrono::duration<double, std::milli>(end - start).count() << "ms"
-                              << std::endl;
-#endif
-                    Timer timer;
-                    do {
-                        if (_terminating) {
-                            break;
+                            flag.remembered &= ~mask;
                         }
-                        auto forceed_count = _forced_collect_count.load(std::memory_order_relaxed);
-                        if (forceed_count) {
-                            forceed_count--;
-                            _forced_collect_count.store(forceed_count, std::memory_order_relaxed);
-                            if (!forceed_count) {
-                                std::lock_guard<std::mutex> lock(_mutex);
-                                if (_live_objects_request) {
-                                    if (_live_objects.size()) {
-                                        auto array = Maker<Tracked_ptr[]>::make_tracked(_live_objects.size());
-                                        for (size_t i = 0; i < _live_objects.size(); ++i) {
-                                            array[i].store(_live_objects[i]);
-                                        }
-                                        auto ref = _live_objects_ref.load();
-                                        *ref = std::move(array);
-                                    }
-                                    std::vector<void*>().swap(_live_objects);
-                                    _live_objects_request = false;
-                                }
-                                _forced_collect_cv.notify_all();
-                            }
-                            else {
-                                if (forceed_count == 1 && _live_objects_ref) {
-                                    std::vector<void*>().swap(_live_objects);
-                                    _live_objects_request = true;
+                    }
+                }
+                _remembered.resize(count);
+            }
+#endif
+
+            void _update_policy() {
+                if (_policy_changed.exchange(false, std::memory_order_acquire)) {
+                    std::lock_guard<std::mutex> lock(_policy_mutex);
+                    _policy = _new_policy;
+                }
+            }
+
+            double _trigger_percentage(int64_t heap_bytes) const noexcept {
+                auto percentage = _policy.trigger_percentage;
+                if (_policy.soft_memory_limit) {
+                    // full percentage up to half of the limit, then linearly down to zero
+                    auto free = 1.0 - (double)heap_bytes / _policy.soft_memory_limit;
+                    percentage *= std::clamp(free * 2, 0.0, 1.0);
+                }
+                return percentage;
+            }
+
+            // splits the allocations left until the trigger between threads, so the GC thread sleeps
+            // until one of them uses up its part instead of polling all thread counters
+            void _wait_for_allocations(const Counter& live, const Counter& last_allocated, double timeout) {
+                if (!_policy.pacer) {
+                    auto percentage = _trigger_percentage(_cycle_stats.heap_bytes + last_allocated.size);
+                    Counter left;
+                    left.count = (int64_t)((live.count + MinLiveCount) * percentage / 100) - last_allocated.count;
+                    left.size = (int64_t)((live.size + MinLiveSize) * percentage / 100) - last_allocated.size;
+                    if (_policy.heap_size_target) {
+                        left.size = std::min(left.size, _policy.heap_size_target - live.size - last_allocated.size);
+                    }
+                    int64_t thread_count = 0;
+                    for (auto data = Thread::threads_data.load(std::memory_order_acquire); data; data = data->next) {
+                        thread_count += !data->is_cached.load(std::memory_order_relaxed);
+                    }
+                    thread_count = std::max(thread_count, int64_t(1));
+                    auto count = std::max(left.count / thread_count, int64_t(1));
+                    auto size = std::max(left.size / thread_count, int64_t(1));
+                    for (auto data = Thread::threads_data.load(std::memory_order_acquire); data; data = data->next) {
+                        data->wakeup_count.store(data->alloc_count.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+                        data->wakeup_size.store(data->alloc_size.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+                    }
+                } else {
+                    timeout = std::min(timeout, _policy.poll_interval);
+                }
+                std::unique_lock<std::mutex> lock(Thread::wakeup_mutex);
+                Thread::wakeup_cv.wait_for(lock, std::chrono::duration<double, std::milli>(std::max(timeout, 0.0)), []{
+                    return Thread::wakeup_pending.load(std::memory_order_relaxed);
+                });
+                Thread::wakeup_pending.store(false, std::memory_order_relaxed);
+            }
+
+            bool _is_triggered(const Counter& live, const Counter& last_allocated, const Counter& last_removed, double sleep_time) const {
+                auto heap_bytes = _cycle_stats.heap_bytes + last_allocated.size;
+                if (_policy.pacer) {
+                    collector_pacing pacing;
+                    pacing.live_objects = live.count;
+                    pacing.live_bytes = live.size;
+                    pacing.allocated_objects = last_allocated.count;
+                    pacing.allocated_bytes = last_allocated.size;
+                    pacing.removed_objects = last_removed.count;
+                    pacing.removed_bytes = last_removed.size;
+                    pacing.heap_bytes = heap_bytes;
+                    pacing.sleep_time = sleep_time;
+                    return _policy.pacer->collect(pacing);
+                }
+                if (_policy.heap_size_target && live.size + last_allocated.size >= _policy.heap_size_target) {
+                    return true;
+                }
+                auto percentage = _trigger_percentage(heap_bytes);
+                return (std::max(last_allocated.count, last_removed.count) * 100 >= (live.count + MinLiveCount) * percentage)
+                    || (std::max(last_allocated.size, last_removed.size) * 100 >= (live.size + MinLiveSize) * percentage);
+            }
+
+            void _update_stats(const Counter& allocated, const Counter& removed, const Counter& last_allocated, const Counter& last_removed, const Counter& live, double time) noexcept {
+                auto& stats = _cycle_stats;
+                ++stats.cycles;
+                stats.allocated_objects = allocated.count;
+                stats.allocated_bytes = allocated.size;
+                stats.removed_objects = removed.count;
+                stats.removed_bytes = removed.size;
+                stats.total_time += time;
+                stats.last_allocated_objects = last_allocated.count;
+                stats.last_allocated_bytes = last_allocated.size;
+                stats.last_removed_objects = last_removed.count;
+                stats.last_removed_bytes = last_removed.size;
+                stats.last_time = time;
+                stats.live_objects = live.count;
+                stats.live_bytes = live.size;
+                _stats.store(stats);
+            }
+
+            void _update_live() noexcept {
+                _last_allocated = _alloc_counter() - _allocated;
+                _live = _allocated + _last_allocated - (_removed + _last_removed);
+            }
+
+            // returns true if a forced cycle has to be started
+            bool _check_forced() {
+                auto forceed_count = _forced_collect_count.load(std::memory_order_relaxed);
+                if (forceed_count) {
+                    forceed_count--;
+                    _forced_collect_count.store(forceed_count, std::memory_order_relaxed);
+                    if (!forceed_count) {
+                        _sweeper.wait();
+                        std::lock_guard<std::mutex> lock(_mutex);
+                        if (_live_objects_request) {
+                            if (_live_objects.size()) {
+                                auto array = Maker<Tracked_ptr[]>::make_tracked(_live_objects.size());
+                                for (size_t i = 0; i < _live_objects.size(); ++i) {
+                                    array[i].store(_live_objects[i]);
                                 }
-                                break;
+                                auto ref = _live_objects_ref.load();
+                                *ref = std::move(array);
                             }
+                            std::vector<void*>().swap(_live_objects);
+                            _live_objects_request = false;
                         }
-                        if ((std::max(last_allocated.count, last_removed.count) * 100 / SGCL_TRIGER_PERCENTAGE >= live.count + MinLiveCount)
-                            || (std::max(last_allocated.size, last_removed.size) * 100 / SGCL_TRIGER_PERCENTAGE >= live.size + MinLiveSize)) {
-                            break;
+                        if (_heap_visitor) {
+                            std::vector<const void*>().swap(_heap_object_edges);
+                            _heap_visitor = nullptr;
                         }
-                        if (max_removed.count > last_allocated.count * 2 && max_removed.count > MinLiveCount
-                            && timer.duration() >= DeletionDelayMsec / (State::ReachableAtomic - 1)) {
-                            break;
+                        _forced_collect_cv.notify_all();
+                    }
+                    else {
+                        if (forceed_count == 1 && _live_objects_ref) {
+                            std::vector<void*>().swap(_live_objects);
+                            _live_objects_request = true;
                         }
-                        std::this_thread::sleep_for(1ms);
-                        last_allocated = _alloc_counter() - allocated;
-                        live = allocated + last_allocated - (removed + last_removed);
-                    } while(!live.count || (timer.duration() < SGCL_MAX_SLEEP_TIME_SEC * 1000));
-                    allocated += last_allocated;
-                    removed += last_removed;
-                    if (!last_removed.count && _terminating) {
-                        if (live.count) {
-                            --finalization_counter;
-                        } else {
-                            finalization_counter = 0;
+                        if (forceed_count == 1) {
+                            _heap_visitor = _heap_visitor_ref.load(std::memory_order_acquire);
+                            _compaction = _compaction_ref.load(std::memory_order_acquire);
+                        }
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            // returns true if the next cycle has to be started, the timeout is the time to wait for allocations
+            bool _is_due(double& timeout) {
+                _update_live();
+                if (_terminating || _check_forced()) {
+                    return true;
+                }
+                _update_policy();
+                auto sleep_time = _sleep_timer.duration();
+                if (_is_triggered(_live, _last_allocated, _last_removed, sleep_time)) {
+                    return true;
+                }
+                if (_live.count && sleep_time >= _policy.max_sleep_time * 1000) {
+                    return true;
+                }
+                timeout = _policy.max_sleep_time * 1000 - (_live.count ? sleep_time : 0);
+                if (_max_removed.count > _last_allocated.count * 2 && _max_removed.count > MinLiveCount) {
+                    double delay = DeletionDelayMsec / (State::ReachableAtomic - 1) - sleep_time;
+                    if (delay <= 0) {
+                        return true;
+                    }
+                    timeout = std::min(timeout, delay);
+                }
+                return false;
+            }
+
+            void _account() noexcept {
+                _allocated += _last_allocated;
+                _removed += _last_removed;
+                if (_terminating && _shutdown_mode != shutdown_mode::finalize) {
+                    // the opted destructors run in one last cycle
+                    bool first = _finalization_counter == FinalizationCycles;
+                    _finalization_counter = _shutdown_mode == shutdown_mode::opted && first ? 1 : 0;
+                } else if (!_last_removed.count && _terminating) {
+                    if (_live.count) {
+                        --_finalization_counter;
+                    } else {
+                        _finalization_counter = 0;
+                    }
+                }
+            }
+
+            void _begin_cycle() {
+                if (_terminating) {
+                    _sweeper.wait();
+                }
+                Timer cycle_timer;
+                _tracer.update();
+                _tracer.begin(collector_phase::check_threads);
+                _check_threads();
+                _tracer.end(collector_phase::check_threads, _cycle_stats.threads);
+                _take_arena_pages();
+                _take_pools();
+#if SGCL_GENERATIONAL
+                _minor = !_terminating && !_live_objects_request && !_heap_visitor && !_forced_collect_count.load(std::memory_order_relaxed) && _minor_count < SGCL_MINOR_CYCLES;
+                _minor_count = _minor ? _minor_count + 1 : 0;
+                _take_remembered_slots();
+#endif
+                _update_pages();
+#if SGCL_GENERATIONAL
+                _update_remembered();
+#endif
+                Timer phase_timer;
+                _traced_objects = 0;
+                _tracer.begin(collector_phase::mark_stack_roots);
+                _mark_stack_roots();
+                _tracer.end(collector_phase::mark_stack_roots, _traced_objects);
+                _traced_objects = 0;
+                _tracer.begin(collector_phase::mark_heap_roots);
+                _mark_heap_roots();
+                _tracer.end(collector_phase::mark_heap_roots, _traced_objects);
+#if SGCL_GENERATIONAL
+                if (_minor) {
+                    _mark_remembered();
+                }
+#endif
+                _cycle_stats.last_roots_time = phase_timer.duration();
+                _cycle_stats.last_mark_time = 0;
+                _cycle_stats.last_sweep_time = 0;
+                _released = {};
+                _phase = Phase::Mark;
+                _cycle_time = cycle_timer.duration();
+            }
+
+            // returns false if the deadline stopped marking
+            template<class D>
+            bool _mark_step(D&& deadline) {
+                Timer phase_timer;
+                _traced_objects = 0;
+                _traced_pages = 0;
+                _tracer.begin(collector_phase::mark);
+                bool done = _mark_objects(deadline) && _release_pins(deadline);
+                if (done && (_clearing_weak || Ephemeron_table::is_used())) {
+                    _clear_weak_references();
+                }
+                _tracer.end(collector_phase::mark, _traced_objects + _traced_marked.exchange(0, std::memory_order_relaxed), _traced_pages);
+                auto time = phase_timer.duration();
+                _cycle_stats.last_mark_time += time;
+                _cycle_time += time;
+                if (done) {
+                    _phase = Phase::Sweep;
+                }
+                return done;
+            }
+
+            // returns false if the deadline stopped marking
+            template<class D>
+            bool _mark_objects(D& deadline) {
+                bool done = true;
+                do {
+                    if (SGCL_MARKING_THREADS && !_live_objects_request && !_heap_visitor) {
+                        _mark_reachable_parallel();
+                    } else if (!_mark_reachable(deadline)) {
+                        done = false;
+                        break;
+                    }
+                    if (_unreachable_pages) {
+                        _mark_updated<false>();
+                    } else {
+                        _mark_updated<true>();
+                    }
+                    if (!_reachable_pages && Ephemeron_table::is_used()) {
+                        _mark_ephemerons();
+                    }
+                    if (_reachable_pages && deadline()) {
+                        done = false;
+                        break;
+                    }
+                } while(_reachable_pages);
+                return done;
+            }
+
+            static bool _is_pinned_before(uint64_t epoch) noexcept {
+                for (auto data = Thread::threads_data.load(std::memory_order_acquire); data; data = data->next) {
+                    auto pin_epoch = data->pin_epoch.load(std::memory_order_seq_cst);
+                    if (pin_epoch && pin_epoch < epoch) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            // objects read within pins begun before the end of marking may be stored after it,
+            // so marking is repeated once these pins are released; the clearing of weak pointers
+            // begins with the epoch, weak pointers read within later pins see unmarked objects as
+            // unreachable, so the same wait covers both; returns false if the deadline stopped waiting
+            template<class D>
+            bool _release_pins(D& deadline) {
+                if (!_pin_epoch) {
+                    _clearing_weak = Weak_table::is_used();
+                    if (_clearing_weak) {
+                        Weak_table::clearing.store(true, std::memory_order_seq_cst);
+                    }
+                    _pin_epoch = Thread::pin_epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+                    _pins_pending = _is_pinned_before(_pin_epoch);
+                }
+                while (_pins_pending) {
+                    if (_is_pinned_before(_pin_epoch)) {
+                        if (deadline()) {
+                            return false;
                         }
+                        // a short timeout, so the deadline is checked
+                        _park_for_pins(_pin_epoch, std::chrono::microseconds(100));
+                        continue;
                     }
-                } while(finalization_counter);
+                    _pins_pending = false;
+                    if (!_mark_objects(deadline)) {
+                        return false;
+                    }
+                }
+                _pin_epoch = 0;
+                return true;
+            }
+
+            static void _wait_for_pins() {
+                auto epoch = Thread::pin_epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+                while (_is_pinned_before(epoch)) {
+                    _park_for_pins(epoch, std::chrono::milliseconds(10));
+                }
+            }
+
+            // parks the collector until the pins begun before the epoch are released or the timeout,
+            // the last unpin of a thread notifies it
+            template<class Duration>
+            static void _park_for_pins(uint64_t epoch, Duration timeout) {
+                Thread::pin_waiting.store(true, std::memory_order_seq_cst);
+                {
+                    std::unique_lock<std::mutex> lock(Thread::pin_mutex);
+                    Thread::pin_cv.wait_for(lock, timeout, [epoch]{
+                        return !_is_pinned_before(epoch);
+                    });
+                }
+                Thread::pin_waiting.store(false, std::memory_order_relaxed);
+            }
+
+            // the values of ephemeron tables are marked once marking of the other objects is done, the
+            // values of marked keys may reach more keys, so the loop of _mark_objects() runs again
+            void _mark_ephemerons() noexcept {
+                Ephemeron_table::for_each_table([this](Ephemeron_table& table) {
+                    table.for_each_entry([this](Pointer& key, Pointer& value) {
+                        if (Page::is_marked(key.load(std::memory_order_relaxed))) {
+                            _mark(value.load(std::memory_order_relaxed));
+                        }
+                    });
+                });
+            }
+
+            // the clearing begins in _release_pins(); later reads see unmarked objects as unreachable,
+            // and the sweep waits for the reads begun before the end of clearing, see Weak_table::load();
+            // the keys of ephemeron tables are held by their users, so their entries are removed
+            // without waiting
+            void _clear_weak_references() {
+                size_t cleared = 0;
+                if (_clearing_weak) {
+                    Weak_table::for_each([&](Pointer& p) {
+                        auto ptr = p.load(std::memory_order_relaxed);
+                        if (ptr && !Page::is_marked(ptr) && p.compare_exchange_strong(ptr, nullptr, std::memory_order_relaxed)) {
+                            ++cleared;
+                        }
+                    });
+                }
+                Ephemeron_table::for_each_table([](Ephemeron_table& table) {
+                    table.remove_if([](const void* key) {
+                        return !Page::is_marked(key);
+                    });
+                });
+                if (_clearing_weak) {
+                    _clearing_weak = false;
+                    Weak_table::clearing.store(false, std::memory_order_seq_cst);
+                    _wait_for_pins();
+                }
+                if (cleared) {
+                    Weak_table::report_cleared(cleared);
+                }
+            }
+
+            // returns false if the deadline stopped sweeping
+            template<class D>
+            bool _sweep_step(D&& deadline) {
+                Timer phase_timer;
+                auto released = _released.count;
+                _traced_pages = 0;
+                _tracer.begin(collector_phase::sweep);
+                bool done = _remove_garbage(deadline);
+                _tracer.end(collector_phase::sweep, _released.count - released, _traced_pages);
+                if (done) {
+#if SGCL_PROFILER
+                    Profiler::update_ages();
+#endif
+#if SGCL_GENERATIONAL
+                    _update_generations();
+#endif
+                    _release_arena_pages();
+                }
+                auto time = phase_timer.duration();
+                _cycle_stats.last_sweep_time += time;
+                _cycle_time += time;
+                return done;
+            }
+
+            void _end_cycle() {
+                Timer phase_timer;
+                _last_removed = _released;
+                _last3_removed[0] = _last3_removed[1];
+                _last3_removed[1] = _last3_removed[2];
+                _last3_removed[2] = _last_removed;
+                _max_removed = max(_last3_removed[0], max(_last3_removed[1], _last3_removed[2]));
+                if (_compaction) {
+                    _compacted = _compact(_compaction);
+                    _compaction = 0;
+                }
+                _tracer.begin(collector_phase::release_pages);
+                _release_unused_pages();
+                _tracer.end(collector_phase::release_pages, 0, _traced_pages);
+                _cycle_stats.last_release_time = phase_timer.duration();
+                _cycle_time += _cycle_stats.last_release_time;
+                _update_live();
+                _live_objects_number.store(_live.count, std::memory_order_release);
+                assert(_live.count >= 0 && _live.size >= 0);
+                _update_stats(_allocated + _last_allocated, _removed + _last_removed, _last_allocated, _last_removed, _live, _cycle_time);
+#if SGCL_LOG_PRINT_LEVEL >= 2
+                std::cout << "[sgcl] live objects: " << _live.count << ", allocated: " << _last_allocated.count << ", destroyed: " << _last_removed.count << ", time: "
+                          << _cycle_time << "ms"
+                          << std::endl;
+#endif
+                _phase = Phase::Idle;
+                _sleep_timer.reset();
+            }
+
+            // continues the current cycle or starts a new one if it is due, returns true if a cycle was completed
+            template<class D>
+            bool _step(D&& deadline) {
+                if (_phase == Phase::Idle) {
+                    double timeout;
+                    if (!_finalization_counter || !_is_due(timeout)) {
+                        return false;
+                    }
+                    _account();
+                    if (!_finalization_counter) {
+                        return false;
+                    }
+                    _begin_cycle();
+                }
+                if (_phase == Phase::Mark && !_mark_step(deadline)) {
+                    return false;
+                }
+                if (!_sweep_step(deadline)) {
+                    return false;
+                }
+                _end_cycle();
+                return true;
+            }
+
+            void _stop() {
+                _sweeper.wait();
+                _sweeper.stop();
 #if SGCL_LOG_PRINT_LEVEL
                 std::cout << "[sgcl] stop collector id: " << std::this_thread::get_id() << std::endl;
 #endif
+                {
+                    std::lock_guard<std::mutex> lock(_marking_mutex);
+                    _marking_stop = true;
+                }
+                _marking_cv.notify_all();
+            }
+
+            void _main_loop() noexcept {
+#if SGCL_LOG_PRINT_LEVEL
+                std::cout << "[sgcl] start collector id: " << std::this_thread::get_id() << std::endl;
+#endif
+                do {
+                    _begin_cycle();
+                    _mark_step(No_deadline());
+                    _sweep_step(No_deadline());
+                    _end_cycle();
+                    double timeout;
+                    while(!_is_due(timeout)) {
+                        _wait_for_allocations(_live, _last_allocated, timeout);
+                    }
+                    _account();
+                } while(_finalization_counter);
+                _stop();
                 if (_terminating) {
                     std::lock_guard<std::mutex> lock(_mutex);
                     _terminated = true;
@@ -700,34 +1968,151 @@ namespace sgcl {
                 }
             }
 
-            void _terminate() noexcept {
+#if SGCL_COOPERATIVE
+            // the cycles of forced collections are run by the calling thread
+            void _run_forced() {
+                std::lock_guard<std::mutex> lock(_step_mutex);
+                while(_forced_collect_count.load(std::memory_order_relaxed) && _finalization_counter) {
+                    _step(No_deadline());
+                }
+            }
+#endif
+
+            // waits until the forced cycles are completed, the lock is taken on _mutex
+            void _wait_for_forced(std::unique_lock<std::mutex>& lock) {
+#if SGCL_COOPERATIVE
+                lock.unlock();
+                _run_forced();
+                lock.lock();
+#else
+                Thread::wake_collector();
+                _forced_collect_cv.wait(lock, [this]{
+                    return _forced_collect_count.load(std::memory_order_relaxed) == 0;
+                });
+#endif
+            }
+
+            void _terminate(shutdown_mode mode = shutdown_mode::finalize) noexcept {
                 std::unique_lock<std::mutex> lock(_mutex);
                 if (!_terminating.load(std::memory_order_relaxed)) {
+                    _shutdown_mode = mode;
 #if SGCL_LOG_PRINT_LEVEL
                     std::cout << "[sgcl] terminate collector from id: " << std::this_thread::get_id() << std::endl;
 #endif
                     _terminating.store(true, std::memory_order_release);
+#if SGCL_COOPERATIVE
+                    // the remaining cycles are run by the calling thread
+                    lock.unlock();
+                    {
+                        std::lock_guard<std::mutex> step_lock(_step_mutex);
+                        while(_finalization_counter) {
+                            _step(No_deadline());
+                        }
+                        _stop();
+                    }
+                    lock.lock();
+                    _terminated = true;
+#else
+                    Thread::wake_collector();
                     _terminate_cv.wait(lock, [this]{
                         return _terminated;
                     });
+#endif
                 }
             }
 
             Page* _reachable_pages = {nullptr};
             Page* _unreachable_pages = {nullptr};
             Page* _registered_pages = {nullptr};
+            std::vector<Page*> _dirty_pages;
+            std::vector<Page*> _release_candidates;
+            // the pages of arena scopes ended before the same cycle
+            struct Arena_batch {
+                std::vector<Page*> pages;
+                Timer timer;
+                unsigned cycles = {0};
+            };
+            std::vector<Arena_batch> _arena_batches;
+            std::vector<std::pair<Data_page*, Block*>> _arena_data;
+            std::vector<Page_pool*> _pools;
+            uint64_t _pin_epoch = {0};
+            bool _pins_pending = {false};
+            bool _clearing_weak = {false};
+#if SGCL_GENERATIONAL
+            std::vector<const void*> _remembered_slots;
+            std::vector<void*> _remembered;
+            // the registered pages by their data address, updated with _registered_pages
+            std::map<uintptr_t, Page*> _heap_pages;
+            unsigned _minor_count = {0};
+            bool _minor = {false};
+#endif
             Counter _allocated_rest;
+            // the state kept between cycles and between the steps of a cycle
+            enum class Phase { Idle, Mark, Sweep };
+            Phase _phase = {Phase::Idle};
+            Counter _allocated;
+            Counter _removed;
+            Counter _last3_removed[3];
+            Counter _last_allocated;
+            Counter _last_removed;
+            Counter _live;
+            Counter _max_removed;
+            Counter _released;
+            int _finalization_counter = {FinalizationCycles};
+            shutdown_mode _shutdown_mode = {shutdown_mode::finalize};
+            double _cycle_time = {0};
+            Timer _sleep_timer;
+#if SGCL_COOPERATIVE
+            std::mutex _step_mutex;
+#endif
             std::atomic<int> _forced_collect_count = {0};
             std::condition_variable _forced_collect_cv;
             std::condition_variable _terminate_cv;
             bool _terminated = {false};
             std::mutex _mutex;
             std::atomic<int64_t> _live_objects_number = {0};
+            collector_stats _cycle_stats;
+            collector_policy _policy;
+            collector_policy _new_policy;
+            mutable std::mutex _policy_mutex;
+            std::atomic<bool> _policy_changed = {false};
+            Stats _stats;
             inline static std::atomic<bool> _terminating = {false};
             inline static std::atomic<bool> _created = {false};
             std::vector<void*> _live_objects;
             std::atomic<Unique_ptr<Tracked_ptr[]>*> _live_objects_ref = {nullptr};
             bool _live_objects_request = {false};
+            std::atomic<heap_visitor*> _heap_visitor_ref = {nullptr};
+            heap_visitor* _heap_visitor = {nullptr};
+            std::vector<const void*>* _heap_edges = {nullptr};
+            std::vector<const void*> _heap_object_edges;
+            std::atomic<double> _compaction_ref = {0};
+            double _compaction = {0};
+            size_t _compacted = {0};
+            Compactor _compactor;
+#if SGCL_MARK_STACK
+            Mark_stack _mark_stack;
+            bool _mark_stack_active = {false};
+#endif
+            std::array<Mark_queue, SGCL_MARKING_THREADS + 1> _mark_queues;
+            std::atomic<int64_t> _pending_pages = {0};
+            // the markers without pages wait for a push or for the end of marking
+            std::mutex _idle_mutex;
+            std::condition_variable _idle_cv;
+            std::atomic<unsigned> _idle_markers = {0};
+            unsigned _idle_signal = {0};
+            std::mutex _marking_mutex;
+            std::condition_variable _marking_cv;
+            std::condition_variable _marking_done_cv;
+            unsigned _marking_phase = {0};
+            unsigned _active_markers = {0};
+            bool _markers_started = {false};
+            bool _marking_stop = {false};
+            Sweeper _sweeper = {_destroy};
+            Phase_tracer _tracer;
+            int64_t _traced_objects = {0};
+            int64_t _traced_pages = {0};
+            std::atomic<int64_t> _traced_marked = {0};
 
             friend inline void Delete_unique(const void*);
         };
@@ -0,0 +1,304 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "../configuration.h"
+#include "array_base.h"
+#include "ephemeron_table.h"
+#include "heap_roots_allocator.h"
+#include "page.h"
+#include "root_blocks.h"
+#include "simd.h"
+#include "stack_roots_allocator.h"
+#include "thread.h"
+#include "weak_table.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace sgcl {
+    namespace Priv {
+        // moves the objects of movable types out of sparse pages into the unused places of denser
+        // pages of the same type and rewrites the tracked pointers to them; run by the collector
+        // after a sweep while no thread uses tracked objects, see collector::compact()
+        struct Compactor {
+            // returns the number of moved objects, the emptied pages are released with the unused pages
+            size_t compact(Page* registered_pages, double occupancy) {
+                _forwarding.clear();
+                _sources.clear();
+                std::unordered_map<Metadata*, std::vector<Candidate>> candidates;
+                for (auto page = registered_pages; page; page = page->next_registered) {
+                    if (!page->is_used || !page->block || page->arena != Page::Arena::None) {
+                        continue;
+                    }
+#if SGCL_PROFILER
+                    if (page->sampled.load(std::memory_order_relaxed)) {
+                        continue;
+                    }
+#endif
+                    auto candidate = _candidate_of(page);
+                    if (candidate.free || candidate.movable) {
+                        candidates[page->metadata].emplace_back(candidate);
+                    }
+                }
+                std::vector<Metadata*> evacuated;
+                for (auto& [metadata, pages] : candidates) {
+                    if (_evacuate(pages, occupancy)) {
+                        evacuated.emplace_back(metadata);
+                    }
+                }
+                if (!_forwarding.empty()) {
+                    std::sort(_sources.begin(), _sources.end());
+                    _forward_objects(registered_pages);
+                    _forward_roots();
+                }
+                std::atomic_thread_fence(std::memory_order_release);
+                // the emptied pages waiting in the buffer of the type are released
+                for (auto metadata : evacuated) {
+                    metadata->free(nullptr);
+                }
+                return _forwarding.size();
+            }
+
+            // the new address of a moved object
+            void* forward(void* ptr) const noexcept {
+                auto it = _forwarding.find(ptr);
+                return it != _forwarding.end() ? it->second : ptr;
+            }
+
+            // the new address of a slot of a moved object, other slots are not changed
+            const void* forward_slot(const void* slot) const noexcept {
+                auto address = (uintptr_t)slot & ~(uintptr_t)(PageSize - 1);
+                if (!std::binary_search(_sources.begin(), _sources.end(), address)) {
+                    return slot;
+                }
+                auto base = Page::base_address_of(slot);
+                return (const void*)((uintptr_t)forward(base) + ((uintptr_t)slot - (uintptr_t)base));
+            }
+
+        private:
+            struct Candidate {
+                Page* page;
+                unsigned live;
+                unsigned free;
+                bool movable;
+            };
+
+            static bool _is_movable(Page* page, unsigned index) noexcept {
+                auto& metadata = page->object_metadata(index);
+                auto user_metadata = metadata.user_metadata;
+                if (metadata.is_array) {
+                    auto array_metadata = ((Array_base*)page->pointer_of(index))->metadata.load(std::memory_order_acquire);
+                    user_metadata = array_metadata ? array_metadata->user_metadata : nullptr;
+                }
+                return user_metadata && user_metadata->movable;
+            }
+
+            // a page can be emptied if all of its objects are registered and movable; one unused place
+            // of a page on the empty list is left to the allocator that takes the page
+            static Candidate _candidate_of(Page* page) noexcept {
+                Candidate candidate = {page, 0, 0, true};
+                auto states = page->states();
+                auto flags = page->flags();
+                for (unsigned i = 0; i < page->metadata->object_count; ++i) {
+                    auto state = states[i].load(std::memory_order_relaxed);
+                    if (state == State::Unused) {
+                        ++candidate.free;
+                    } else {
+                        ++candidate.live;
+                        candidate.movable = candidate.movable
+                            && state <= State::ReachableAtomic
+                            && (flags[Page::flag_index_of(i)].registered & Page::flag_mask_of(i))
+                            && _is_movable(page, i);
+                    }
+                }
+                if (candidate.free && page->on_empty_list.load(std::memory_order_acquire)) {
+                    --candidate.free;
+                }
+                candidate.movable = candidate.movable && candidate.live;
+                return candidate;
+            }
+
+            // the sparsest pages are emptied into the densest ones, as long as the pages
+            // denser than a source have enough unused places for all of its objects
+            bool _evacuate(std::vector<Candidate>& pages, double occupancy) noexcept {
+                std::sort(pages.begin(), pages.end(), [](const Candidate& a, const Candidate& b) {
+                    return a.live > b.live;
+                });
+                size_t capacity = 0;
+                for (auto& page : pages) {
+                    capacity += page.free;
+                }
+                bool evacuated = false;
+                size_t target = 0;
+                unsigned place = 0;
+                for (size_t s = pages.size(); s-- > target + 1;) {
+                    auto& source = pages[s];
+                    capacity -= source.free;
+                    if (source.live > occupancy * source.page->metadata->object_count) {
+                        break;
+                    }
+                    if (!source.movable || source.live > capacity) {
+                        continue;
+                    }
+                    auto states = source.page->states();
+                    for (unsigned i = 0; i < source.page->metadata->object_count; ++i) {
+                        if (states[i].load(std::memory_order_relaxed) == State::Unused) {
+                            continue;
+                        }
+                        while (!pages[target].free) {
+                            ++target;
+                            place = 0;
+                        }
+                        auto& destination = pages[target];
+                        auto destination_states = destination.page->states();
+                        while (destination_states[place].load(std::memory_order_relaxed) != State::Unused) {
+                            ++place;
+                        }
+                        _move(source.page, i, destination.page, place);
+                        --destination.free;
+                    }
+                    capacity -= source.live;
+                    _sources.emplace_back(source.page->data & ~(uintptr_t)(PageSize - 1));
+                    evacuated = true;
+                }
+                return evacuated;
+            }
+
+            template<class F>
+            static void _move_bit(F& from, Page::Flag from_mask, F& to, Page::Flag to_mask) noexcept {
+                if (from & from_mask) {
+                    from &= ~from_mask;
+                    to |= to_mask;
+                }
+            }
+
+            template<class F>
+            static void _move_bit(std::atomic<F>& from, Page::Flag from_mask, std::atomic<F>& to, Page::Flag to_mask) noexcept {
+                auto from_bits = from.load(std::memory_order_relaxed);
+                if (from_bits & from_mask) {
+                    from.store(from_bits & ~from_mask, std::memory_order_relaxed);
+                    to.store(to.load(std::memory_order_relaxed) | to_mask, std::memory_order_relaxed);
+                }
+            }
+
+            void _move(Page* from_page, unsigned from, Page* to_page, unsigned to) {
+                auto source = from_page->pointer_of(from);
+                auto destination = to_page->pointer_of(to);
+                std::memcpy(destination, source, from_page->metadata->object_size);
+                from_page->clear(from);
+                if (from_page->types) {
+                    to_page->types[to] = from_page->types[from];
+                }
+                auto& from_flag = from_page->flags()[Page::flag_index_of(from)];
+                auto& to_flag = to_page->flags()[Page::flag_index_of(to)];
+                auto from_mask = Page::flag_mask_of(from);
+                auto to_mask = Page::flag_mask_of(to);
+                _move_bit(from_flag.registered, from_mask, to_flag.registered, to_mask);
+                _move_bit(from_flag.marked, from_mask, to_flag.marked, to_mask);
+#if SGCL_GENERATIONAL
+                _move_bit(from_flag.old, from_mask, to_flag.old, to_mask);
+                _move_bit(from_flag.survived, from_mask, to_flag.survived, to_mask);
+                _move_bit(from_flag.remembered, from_mask, to_flag.remembered, to_mask);
+#endif
+                auto state = from_page->states()[from].load(std::memory_order_relaxed);
+                to_page->states()[to].store(state, std::memory_order_relaxed);
+                from_page->states()[from].store(State::Unused, std::memory_order_relaxed);
+                // the state of a recently stored object is aged on dirty pages only
+                if (state != State::Used) {
+                    to_page->set_dirty();
+                }
+                _forwarding.emplace(source, destination);
+            }
+
+            void _forward(Pointer& p) const noexcept {
+                auto ptr = p.load(std::memory_order_relaxed);
+                if (ptr && (size_t)ptr != std::numeric_limits<size_t>::max()) {
+                    auto base = Page::base_address_of(ptr);
+                    auto it = _forwarding.find(base);
+                    if (it != _forwarding.end()) {
+                        p.store((void*)((uintptr_t)it->second + ((uintptr_t)ptr - (uintptr_t)base)), std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            void _forward_childs(void* ptr, const Child_pointers::Offsets& offsets) const noexcept {
+                for (auto offset : offsets) {
+                    _forward(*(Pointer*)((uintptr_t)ptr + offset));
+                }
+            }
+
+            void _forward_childs(void* ptr, const Child_pointers::Map& map) const noexcept {
+                for (unsigned index = 0; index < map.size(); ++index) {
+                    auto flags = map[index].load(std::memory_order_acquire);
+                    for (unsigned i = 0; flags && i < 8; ++i) {
+                        if (flags & (1 << i)) {
+                            _forward(*(Pointer*)((uintptr_t)ptr + (index * 8 + i) * sizeof(Pointer)));
+                        }
+                    }
+                }
+            }
+
+            void _forward_childs(Child_pointers& pointers, void* ptr) const noexcept {
+                auto offsets = pointers.offsets.load(std::memory_order_acquire);
+                if (offsets) {
+                    _forward_childs(ptr, *offsets);
+                } else {
+                    _forward_childs(ptr, pointers.map);
+                }
+            }
+
+            void _forward_childs(Page* page, unsigned index) const noexcept {
+                auto ptr = page->pointer_of(index);
+                auto& metadata = page->object_metadata(index);
+                if (!metadata.is_array) {
+                    _forward_childs(metadata.child_pointers, ptr);
+                    return;
+                }
+                auto array = (Array_base*)ptr;
+                auto array_metadata = array->metadata.load(std::memory_order_acquire);
+                if (array_metadata) {
+                    auto data = (uintptr_t)ptr + sizeof(Array_base);
+                    for (size_t c = 0; c < array->count; ++c, data += array_metadata->object_size) {
+                        _forward_childs(array_metadata->child_pointers, (void*)data);
+                    }
+                }
+            }
+
+            // the moved objects are visited at their new places
+            void _forward_objects(Page* registered_pages) const noexcept {
+                for (auto page = registered_pages; page; page = page->next_registered) {
+                    if (!page->is_used) {
+                        continue;
+                    }
+                    State_scan::for_each(page->states(), page->metadata->object_count, State::Used, State::UniqueLock, [&](unsigned i) {
+                        _forward_childs(page, i);
+                    });
+                }
+            }
+
+            void _forward_roots() const noexcept {
+                auto forward = [this](Pointer& p) {
+                    _forward(p);
+                };
+                for (auto data = Thread::threads_data.load(std::memory_order_acquire); data; data = data->next) {
+                    data->stack_roots_allocator->for_each(forward);
+                }
+                Heap_roots_allocator::for_each(forward);
+                Root_blocks::for_each(forward);
+                Weak_table::for_each(forward);
+                Ephemeron_table::for_each_table([&](Ephemeron_table& table) {
+                    table.forward(forward);
+                });
+            }
+
+            std::unordered_map<const void*, void*> _forwarding;
+            std::vector<uintptr_t> _sources;
+        };
+    }
+}
@@ -5,11 +5,13 @@
 //------------------------------------------------------------------------------
 #pragma once
 
+#include "../configuration.h"
 #include "types.h"
 
 namespace sgcl {
     namespace Priv {
-        static constexpr size_t PageSize = 4096;
+        static constexpr size_t PageSize = SGCL_PAGE_SIZE;
+        static_assert(PageSize >= 4096 && (PageSize & (PageSize - 1)) == 0, "SGCL_PAGE_SIZE must be a power of two of at least 4096");
         static constexpr size_t PageDataSize = PageSize - sizeof(uintptr_t);
 
         struct Data_page {
@@ -0,0 +1,228 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "maker.h"
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace sgcl {
+    namespace Priv {
+        // the graph is copied level by level, the pointers of a copy lead to the originals until
+        // all objects are copied, so the originals stay reachable without pinning; the copies are
+        // unique until the edges are rewired and only the root copy stays unique at the end
+        struct Deep_clone {
+            // the levels and the rewiring with at least that many objects are split across threads
+            static constexpr size_t ParallelCount = 0x1000;
+
+            static void* clone(const void* p) {
+                if (!p) {
+                    return nullptr;
+                }
+                auto base = Page::base_address_of(p);
+                Deep_clone graph;
+                graph._index.emplace(base, 0);
+                graph._objects.push_back(base);
+                graph._clones.push_back(nullptr);
+                try {
+                    graph._clone_levels();
+                } catch (...) {
+                    graph._delete_clones();
+                    throw;
+                }
+                graph._rewire();
+                auto root = graph._clones[0];
+                return root ? (char*)root + ((const char*)p - (const char*)base) : nullptr;
+            }
+
+        private:
+            void _clone_levels() {
+                size_t begin = 0;
+                while (begin < _objects.size()) {
+                    size_t end = _objects.size();
+                    _parallel_for(begin, end, [this](size_t i) {
+                        _clones[i] = _clone_object(_objects[i]);
+                    });
+                    for (size_t i = begin; i < end; ++i) {
+                        if (_clones[i]) {
+                            _for_each_child(_clones[i], [this](Pointer& child) {
+                                auto p = child.load(std::memory_order_relaxed);
+                                auto base = Page::base_address_of(p);
+                                if (_index.emplace(base, _objects.size()).second) {
+                                    _objects.push_back(base);
+                                    _clones.push_back(nullptr);
+                                }
+                            });
+                        }
+                    }
+                    begin = end;
+                }
+            }
+
+            // the stores do not lower the unique state, the copies are released after all edges are set
+            void _rewire() noexcept {
+                _parallel_for(0, _clones.size(), [this](size_t i) {
+                    if (_clones[i]) {
+                        _for_each_child(_clones[i], [this](Pointer& child) {
+                            auto p = child.load(std::memory_order_relaxed);
+                            auto base = Page::base_address_of(p);
+                            auto clone = _clones[_index.find(base)->second];
+                            auto& ptr = (Tracked_ptr&)child;
+                            if (clone) {
+                                ptr.store((char*)clone + ((char*)p - (char*)base));
+                                ptr.remember();
+                            } else {
+                                ptr.store(nullptr);
+                            }
+                        });
+                    }
+                });
+                _parallel_for(1, _clones.size(), [this](size_t i) {
+                    if (_clones[i]) {
+                        Page::set_state(_clones[i], State::Reachable);
+                    }
+                });
+            }
+
+            void _delete_clones() noexcept {
+                for (auto clone : _clones) {
+                    if (clone) {
+                        Delete_unique(clone);
+                    }
+                }
+            }
+
+            static void* _clone_object(void* base) {
+                auto& metadata = Page::metadata_of(base);
+                if (metadata.is_array) {
+                    auto array = (Array_base*)base;
+                    auto array_metadata = array->metadata.load(std::memory_order_acquire);
+                    auto data = array_metadata->clone((char*)base + sizeof(Array_base));
+                    return data ? Page::base_address_of(data) : nullptr;
+                } else {
+                    return metadata.clone(base);
+                }
+            }
+
+            template<class F>
+            static void _for_each_child(void* ptr, const Child_pointers::Offsets& offsets, F& f) {
+                for (auto offset : offsets) {
+                    auto& p = *(Pointer*)((uintptr_t)ptr + offset);
+                    _visit(p, f);
+                }
+            }
+
+            template<class F>
+            static void _for_each_child(void* ptr, const Child_pointers::Map& map, F& f) {
+                for (unsigned index = 0; index < map.size(); ++index) {
+                    auto flags = map[index].load(std::memory_order_acquire);
+                    for (unsigned i = 0; flags && i < 8; ++i) {
+                        if (flags & (1 << i)) {
+                            auto offset = (index * 8 + i) * sizeof(Pointer);
+                            auto& p = *(Pointer*)((uintptr_t)ptr + offset);
+                            _visit(p, f);
+                        }
+                    }
+                }
+            }
+
+            template<class F>
+            static void _for_each_child(Child_pointers& pointers, void* ptr, F& f) {
+                auto offsets = pointers.offsets.load(std::memory_order_acquire);
+                if (offsets) {
+                    _for_each_child(ptr, *offsets, f);
+                } else {
+                    _for_each_child(ptr, pointers.map, f);
+                }
+            }
+
+            template<class F>
+            static void _for_each_child(void* base, F&& f) {
+                auto& metadata = Page::metadata_of(base);
+                if (!metadata.is_array) {
+                    _for_each_child(metadata.child_pointers, base, f);
+                } else {
+                    auto array = (Array_base*)base;
+                    auto array_metadata = array->metadata.load(std::memory_order_acquire);
+                    auto& pointers = array_metadata->child_pointers;
+                    auto offsets = pointers.offsets.load(std::memory_order_acquire);
+                    if (offsets && !offsets->size()) {
+                        return;
+                    }
+                    auto data = (uintptr_t)base + sizeof(Array_base);
+                    for (size_t c = 0; c < array->count; ++c, data += array_metadata->object_size) {
+                        _for_each_child(pointers, (void*)data, f);
+                    }
+                }
+            }
+
+            template<class F>
+            static void _visit(Pointer& p, F& f) {
+                auto v = p.load(std::memory_order_relaxed);
+                if (v && (size_t)v != std::numeric_limits<size_t>::max()) {
+                    f(p);
+                }
+            }
+
+            // the first exception of the threads is rethrown after all of them are joined,
+            // the chunks of threads that could not be started are run by the calling thread
+            template<class F>
+            static void _parallel_for(size_t begin, size_t end, F&& f) {
+                size_t count = end - begin;
+                unsigned threads_count = std::max(std::thread::hardware_concurrency(), 1u);
+                if (count < ParallelCount || threads_count == 1) {
+                    for (size_t i = begin; i < end; ++i) {
+                        f(i);
+                    }
+                    return;
+                }
+                threads_count = (unsigned)std::min<size_t>(threads_count, count / (ParallelCount / 4));
+                size_t chunk = (count + threads_count - 1) / threads_count;
+                std::vector<std::exception_ptr> errors(threads_count);
+                auto run = [&](unsigned t) {
+                    auto first = begin + t * chunk;
+                    auto last = std::min(first + chunk, end);
+                    try {
+                        for (size_t i = first; i < last; ++i) {
+                            f(i);
+                        }
+                    } catch (...) {
+                        errors[t] = std::current_exception();
+                    }
+                };
+                std::vector<std::thread> threads;
+                threads.reserve(threads_count);
+                unsigned started = 1;
+                try {
+                    for (; started < threads_count; ++started) {
+                        threads.emplace_back(run, started);
+                    }
+                } catch (...) {
+                }
+                run(0);
+                for (unsigned t = started; t < threads_count; ++t) {
+                    run(t);
+                }
+                for (auto& thread : threads) {
+                    thread.join();
+                }
+                for (auto& error : errors) {
+                    if (error) {
+                        std::rethrow_exception(error);
+                    }
+                }
+            }
+
+            std::vector<void*> _objects;
+            std::vector<void*> _clones;
+            std::unordered_map<const void*, size_t> _index;
+        };
+    }
+}
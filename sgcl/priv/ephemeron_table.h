@@ -0,0 +1,244 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "page.h"
+#include "types.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace sgcl {
+    namespace Priv {
+        // an open addressing hash table with linear probing of the entries of an ephemeron_map, stored
+        // outside of the managed heap; the collector marks the value of an entry once its key is marked
+        // and removes the entries of unmarked keys before the sweep, see Collector::_mark_ephemerons();
+        // a value may be set after the last pass over the tables and lose its other references before
+        // the sweep, so set() gives it the Reachable state like the stores of tracked_ptr; entries moved
+        // by erase or a rehash keep their values without it, the values of removed keys stay unmarked
+        class Ephemeron_table {
+        public:
+            struct Entry {
+                Pointer key = {nullptr};
+                Pointer value = {nullptr};
+            };
+
+            Ephemeron_table() {
+                std::lock_guard<std::mutex> lock(_tables_mutex);
+                _next = _tables;
+                if (_next) {
+                    _next->_prev = this;
+                }
+                _tables = this;
+                _table_count.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            Ephemeron_table(const Ephemeron_table&) = delete;
+            Ephemeron_table& operator=(const Ephemeron_table&) = delete;
+
+            ~Ephemeron_table() {
+                std::lock_guard<std::mutex> lock(_tables_mutex);
+                if (_prev) {
+                    _prev->_next = _next;
+                } else {
+                    _tables = _next;
+                }
+                if (_next) {
+                    _next->_prev = _prev;
+                }
+                _table_count.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            size_t size() const noexcept {
+                std::lock_guard<std::mutex> lock(_mutex);
+                return _size;
+            }
+
+            // the value is passed to f under the lock of the table
+            template<class F>
+            bool get(const void* key, F&& f) const {
+                std::lock_guard<std::mutex> lock(_mutex);
+                auto index = _find(key);
+                if (index == _capacity) {
+                    return false;
+                }
+                f(_entries[index].value.load(std::memory_order_relaxed));
+                return true;
+            }
+
+            void set(const void* key, const void* value) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                auto index = _find(key);
+                if (index == _capacity) {
+                    if ((_size + 1) * MaxLoadDenominator > _capacity * MaxLoadNumerator) {
+                        _rehash(std::max(_capacity * 2, MinCapacity));
+                    }
+                    index = _insert(key);
+                    ++_size;
+                }
+                _entries[index].value.store(const_cast<void*>(value), std::memory_order_relaxed);
+                if (value) {
+                    Page::update_state(value, State::Reachable);
+                }
+            }
+
+            bool erase(const void* key) noexcept {
+                std::lock_guard<std::mutex> lock(_mutex);
+                auto index = _find(key);
+                if (index == _capacity) {
+                    return false;
+                }
+                _erase(index);
+                return true;
+            }
+
+            void clear() noexcept {
+                std::lock_guard<std::mutex> lock(_mutex);
+                for (size_t i = 0; i < _capacity; ++i) {
+                    _entries[i].key.store(nullptr, std::memory_order_relaxed);
+                    _entries[i].value.store(nullptr, std::memory_order_relaxed);
+                }
+                _size = 0;
+            }
+
+            static bool is_used() noexcept {
+                return _table_count.load(std::memory_order_relaxed);
+            }
+
+            // called by the collector, f visits the tables under their locks
+            template<class F>
+            static void for_each_table(F&& f) {
+                std::lock_guard<std::mutex> tables_lock(_tables_mutex);
+                for (auto table = _tables; table; table = table->_next) {
+                    std::lock_guard<std::mutex> lock(table->_mutex);
+                    f(*table);
+                }
+            }
+
+            template<class F>
+            void for_each_entry(F&& f) noexcept {
+                for (size_t i = 0; i < _capacity; ++i) {
+                    auto& entry = _entries[i];
+                    if (entry.key.load(std::memory_order_relaxed)) {
+                        f(entry.key, entry.value);
+                    }
+                }
+            }
+
+            // returns the number of removed entries
+            template<class F>
+            size_t remove_if(F&& f) {
+                size_t removed = 0;
+                for (size_t i = 0; i < _capacity; ++i) {
+                    auto key = _entries[i].key.load(std::memory_order_relaxed);
+                    if (key && f(key)) {
+                        _entries[i].key.store(nullptr, std::memory_order_relaxed);
+                        _entries[i].value.store(nullptr, std::memory_order_relaxed);
+                        ++removed;
+                    }
+                }
+                if (removed) {
+                    // the probe sequences have gaps, so the entries are inserted again
+                    _size -= removed;
+                    _rehash(_capacity);
+                }
+                return removed;
+            }
+
+            // moved keys change their hashes, so the entries are inserted again
+            template<class F>
+            void forward(F&& f) {
+                for_each_entry([&](Pointer& key, Pointer& value) {
+                    f(key);
+                    f(value);
+                });
+                _rehash(_capacity);
+            }
+
+        private:
+            static constexpr size_t MinCapacity = 8;
+            static constexpr size_t MaxLoadNumerator = 3;
+            static constexpr size_t MaxLoadDenominator = 4;
+
+            // the low bits of addresses are always zero
+            static size_t _hash_of(const void* key) noexcept {
+                auto hash = (uint64_t)(uintptr_t)key * 0x9E3779B97F4A7C15ull;
+                return size_t(hash ^ (hash >> 32));
+            }
+
+            size_t _find(const void* key) const noexcept {
+                if (!_size) {
+                    return _capacity;
+                }
+                auto mask = _capacity - 1;
+                for (auto index = _hash_of(key) & mask;; index = (index + 1) & mask) {
+                    auto k = _entries[index].key.load(std::memory_order_relaxed);
+                    if (!k) {
+                        return _capacity;
+                    }
+                    if (k == key) {
+                        return index;
+                    }
+                }
+            }
+
+            size_t _insert(const void* key) noexcept {
+                auto mask = _capacity - 1;
+                auto index = _hash_of(key) & mask;
+                while (_entries[index].key.load(std::memory_order_relaxed)) {
+                    index = (index + 1) & mask;
+                }
+                _entries[index].key.store(const_cast<void*>(key), std::memory_order_relaxed);
+                return index;
+            }
+
+            // backward shift deletion, the probe sequences stay without gaps
+            void _erase(size_t index) noexcept {
+                auto mask = _capacity - 1;
+                auto next = (index + 1) & mask;
+                while (auto key = _entries[next].key.load(std::memory_order_relaxed)) {
+                    auto home = _hash_of(key) & mask;
+                    if (((next - home) & mask) >= ((next - index) & mask)) {
+                        _entries[index].key.store(key, std::memory_order_relaxed);
+                        _entries[index].value.store(_entries[next].value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                        index = next;
+                    }
+                    next = (next + 1) & mask;
+                }
+                _entries[index].key.store(nullptr, std::memory_order_relaxed);
+                _entries[index].value.store(nullptr, std::memory_order_relaxed);
+                --_size;
+            }
+
+            void _rehash(size_t capacity) {
+                auto entries = std::move(_entries);
+                auto old_capacity = _capacity;
+                _entries = std::make_unique<Entry[]>(capacity);
+                _capacity = capacity;
+                for (size_t i = 0; i < old_capacity; ++i) {
+                    if (auto key = entries[i].key.load(std::memory_order_relaxed)) {
+                        auto index = _insert(key);
+                        _entries[index].value.store(entries[i].value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            mutable std::mutex _mutex;
+            std::unique_ptr<Entry[]> _entries;
+            size_t _capacity = {0};
+            size_t _size = {0};
+            Ephemeron_table* _prev = {nullptr};
+            Ephemeron_table* _next = {nullptr};
+
+            inline static std::mutex _tables_mutex;
+            inline static Ephemeron_table* _tables = {nullptr};
+            inline static std::atomic<size_t> _table_count = {0};
+        };
+    }
+}
@@ -6,97 +6,152 @@
 #pragma once
 
 #include "data_page.h"
-#include "pointer_pool.h"
+#include "simd.h"
+
+#include <mutex>
 
 namespace sgcl {
     namespace Priv {
+        // a thread allocates roots from its own page, any thread frees them by clearing the bit of
+        // the slot; the collector scans the set bits and takes the released pages back
         struct Heap_roots_allocator {
-            static constexpr size_t PointerCount = PageSize / sizeof(Pointer);
-            using Page = std::array<Pointer, PointerCount>;
-            using Pointer_pool = Priv::Pointer_pool<PointerCount, sizeof(Pointer)>;
+            static constexpr unsigned WordBits = 64;
+            static constexpr unsigned WordCount = PageSize / sizeof(Pointer) / WordBits;
+
+            enum class Owner : uint8_t {Thread, None, Listed};
 
-            struct Page_node {
+            struct Page_node;
+
+            struct Page_header {
                 Page_node* next = {nullptr};
-                Page page = {};
+                Page_node* next_listed = {nullptr};
+                std::atomic<Owner> owner = {Owner::Thread};
+                std::atomic<uint64_t> used[WordCount] = {};
             };
 
-            constexpr Heap_roots_allocator() noexcept
-                :_pointer_pool({nullptr, nullptr}) {
-            }
+            static constexpr size_t PointerCount = (PageSize - sizeof(Page_header)) / sizeof(Pointer);
+
+            // a slot finds its page by the address
+            struct alignas(PageSize) Page_node : Page_header {
+                Pointer pointers[PointerCount] = {};
+            };
+            static_assert(sizeof(Page_node) == PageSize);
+
+            constexpr Heap_roots_allocator() noexcept = default;
 
             ~Heap_roots_allocator() noexcept {
-                for(auto pointer_pool : _pointer_pool) {
-                    if (pointer_pool) {
-                        auto& pool = pointer_pool->is_empty() ? _global_empty_pointer_pool : _global_pointer_pool;
-                        pointer_pool->next = pool.load(std::memory_order_acquire);
-                        while(!pool.compare_exchange_weak(pointer_pool->next, pointer_pool, std::memory_order_release, std::memory_order_relaxed));
-                    }
+                if (_page) {
+                    _page->owner.store(Owner::None, std::memory_order_release);
                 }
             }
 
             Tracked_ptr* alloc() {
-                auto [pool1, pool2] = _pointer_pool;
-                if (pool1 && !pool1->is_empty()) {
-                    return (Tracked_ptr*)pool1->alloc();
-                }
-                if (pool2 && !pool2->is_empty()) {
-                    _pointer_pool = {pool2, pool1};
-                    return (Tracked_ptr*)pool2->alloc();
+                if (!_page || !_alloc_bit()) {
+                    _take_page();
+                    _alloc_bit();
                 }
-                auto new_pool = _global_pointer_pool.load(std::memory_order_acquire);
-                while(new_pool && !_global_pointer_pool.compare_exchange_weak(new_pool, new_pool->next, std::memory_order_release, std::memory_order_acquire));
-                if (!new_pool) {
-                    auto node = new Page_node;
-                    new_pool = new Pointer_pool(node->page.data());
-                    node->next = pages.load(std::memory_order_acquire);
-                    while(!pages.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed));
-                }
-                if (pool1) {
-                    if (pool2) {
-                        pool2->next = _global_empty_pointer_pool.load(std::memory_order_acquire);
-                        while(!_global_empty_pointer_pool.compare_exchange_weak(pool2->next, pool2, std::memory_order_release, std::memory_order_relaxed));
+                auto index = _word * WordBits + _bit;
+                return (Tracked_ptr*)&_page->pointers[index];
+            }
+
+            static void free(Tracked_ptr* p) noexcept {
+                auto page = (Page_node*)((uintptr_t)p & ~(uintptr_t)(PageSize - 1));
+                auto index = (Pointer*)p - page->pointers;
+                page->used[index / WordBits].fetch_and(~(uint64_t(1) << (index % WordBits)), std::memory_order_release);
+            }
+
+            // called by the collector only
+            template<class F>
+            static void for_each(F&& f) {
+                for (auto page = pages.load(std::memory_order_acquire); page; page = page->next) {
+                    for (unsigned i = 0; i < WordCount; ++i) {
+                        For_each_bit(page->used[i].load(std::memory_order_acquire) & _mask_of(i), [&](unsigned j) {
+                            f(page->pointers[i * WordBits + j]);
+                        });
                     }
-                    pool2 = pool1;
                 }
-                pool1 = new_pool;
-                _pointer_pool = {pool1, pool2};
-                return (Tracked_ptr*)pool1->alloc();
             }
 
-            void free(Tracked_ptr* p) noexcept {
-                auto [pool1, pool2] = _pointer_pool;
-                if (pool1 && !pool1->is_full()) {
-                    pool1->free(p);
-                    return;
-                }
-                if (pool2 && !pool2->is_full()) {
-                    pool2->free(p);
-                    _pointer_pool = {pool2, pool1};
-                    return;
-                }
-                auto new_pool = _global_empty_pointer_pool.load(std::memory_order_acquire);
-                while(new_pool && !_global_empty_pointer_pool.compare_exchange_weak(new_pool, new_pool->next, std::memory_order_relaxed, std::memory_order_acquire));
-                if (!new_pool) {
-                    new_pool = new Pointer_pool();
-                }
-                if (pool1) {
-                    if (pool2) {
-                        pool2->next = _global_pointer_pool.load(std::memory_order_acquire);
-                        while(!_global_pointer_pool.compare_exchange_weak(pool2->next, pool2, std::memory_order_release, std::memory_order_relaxed));
+            // called by the collector only, the empty pages without an owner are deleted,
+            // the pages with at least a quarter of free slots are listed for threads
+            static void update_pages() {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _listed_pages = nullptr;
+                Page_node* prev = nullptr;
+                auto page = pages.load(std::memory_order_acquire);
+                while(page) {
+                    auto next = page->next;
+                    if (page->owner.load(std::memory_order_acquire) != Owner::Thread) {
+                        unsigned count = 0;
+                        for (unsigned i = 0; i < WordCount; ++i) {
+                            count += Popcount(page->used[i].load(std::memory_order_acquire) & _mask_of(i));
+                        }
+                        if (!count) {
+                            if (prev) {
+                                prev->next = next;
+                            } else {
+                                pages.store(next, std::memory_order_release);
+                            }
+                            delete page;
+                            page = next;
+                            continue;
+                        }
+                        if (PointerCount - count >= PointerCount / 4) {
+                            page->owner.store(Owner::Listed, std::memory_order_relaxed);
+                            page->next_listed = _listed_pages;
+                            _listed_pages = page;
+                        } else {
+                            page->owner.store(Owner::None, std::memory_order_relaxed);
+                        }
                     }
-                    pool2 = pool1;
+                    prev = page;
+                    page = next;
                 }
-                pool1 = new_pool;
-                _pointer_pool = {pool1, pool2};
-                pool1->free(p);
             }
 
             inline static std::atomic<Page_node*> pages = {nullptr};
 
         private:
-            std::array<Pointer_pool*, 2> _pointer_pool;
-            inline static std::atomic<Pointer_pool*> _global_pointer_pool = {nullptr};
-            inline static std::atomic<Pointer_pool*> _global_empty_pointer_pool = {nullptr};
+            static constexpr uint64_t _mask_of(unsigned word) noexcept {
+                auto count = PointerCount - word * WordBits;
+                return count >= WordBits ? ~uint64_t(0) : (uint64_t(1) << count) - 1;
+            }
+
+            // only the owner sets bits, other threads clear them
+            bool _alloc_bit() noexcept {
+                for (unsigned i = 0; i < WordCount; ++i, _word = (_word + 1) % WordCount) {
+                    auto free = ~_page->used[_word].load(std::memory_order_relaxed) & _mask_of(_word);
+                    if (free) {
+                        _bit = Countr_zero(free);
+                        _page->used[_word].fetch_or(uint64_t(1) << _bit, std::memory_order_relaxed);
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            void _take_page() {
+                if (_page) {
+                    _page->owner.store(Owner::None, std::memory_order_release);
+                }
+                std::lock_guard<std::mutex> lock(_mutex);
+                _page = _listed_pages;
+                if (_page) {
+                    _listed_pages = _page->next_listed;
+                    _page->owner.store(Owner::Thread, std::memory_order_relaxed);
+                } else {
+                    _page = new Page_node;
+                    _page->next = pages.load(std::memory_order_relaxed);
+                    pages.store(_page, std::memory_order_release);
+                }
+                _word = 0;
+            }
+
+            Page_node* _page = {nullptr};
+            unsigned _word = {0};
+            unsigned _bit = {0};
+            inline static std::mutex _mutex;
+            inline static Page_node* _listed_pages = {nullptr};
         };
     }
 }
@@ -0,0 +1,72 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "../heap_snapshot.h"
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <typeindex>
+#include <unordered_map>
+
+namespace sgcl {
+    namespace Priv {
+        // the "SGCLHEAP" magic and a version byte followed by records, all numbers are LEB128 varints:
+        // 'T' type id, name length, mangled name - written before the first object of the type
+        // 'R' address of a rooted object
+        // 'O' address, type id, size, edge count, edge addresses
+        struct Heap_snapshot_writer : heap_visitor {
+            static constexpr uint8_t Version = 1;
+
+            Heap_snapshot_writer(std::ostream& out)
+            : _out(out) {
+                _out.write("SGCLHEAP", 8);
+                _out.put(Version);
+            }
+
+            void visit(const heap_object& object) override {
+                auto [type, inserted] = _types.try_emplace(object.type, _types.size());
+                if (inserted) {
+                    auto name = object.type.name();
+                    auto length = std::strlen(name);
+                    _out.put('T');
+                    _varint(type->second);
+                    _varint(length);
+                    _out.write(name, length);
+                }
+                _out.put('O');
+                _varint((uintptr_t)object.address);
+                _varint(type->second);
+                _varint(object.size);
+                _varint(object.edge_count);
+                for (size_t i = 0; i < object.edge_count; ++i) {
+                    _varint((uintptr_t)object.edges[i]);
+                }
+            }
+
+            void visit_root(const void* p) override {
+                _out.put('R');
+                _varint((uintptr_t)p);
+            }
+
+        private:
+            void _varint(uint64_t v) {
+                char buffer[10];
+                unsigned size = 0;
+                while (v >= 0x80) {
+                    buffer[size++] = (char)(v | 0x80);
+                    v >>= 7;
+                }
+                buffer[size++] = (char)v;
+                _out.write(buffer, size);
+            }
+
+            std::ostream& _out;
+            std::unordered_map<std::type_index, uint64_t> _types;
+        };
+    }
+}
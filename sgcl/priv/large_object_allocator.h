@@ -5,32 +5,182 @@
 //------------------------------------------------------------------------------
 #pragma once
 
+#include "../configuration.h"
 #include "data_page.h"
 #include "object_allocator.h"
 #include "type_info.h"
 
+#include <array>
+#include <mutex>
+#include <new>
+#include <tuple>
+
+#if SGCL_LATENCY_HISTOGRAMS
+#include "latency.h"
+#endif
+
+#if SGCL_LARGE_MMAP_THRESHOLD && (defined(__unix__) || defined(__APPLE__))
+#include <sys/mman.h>
+#define SGCL_LARGE_MMAP
+#endif
+
 namespace sgcl {
     namespace Priv {
+        // regions are rounded up to a quarter of a power of two pages and freed ones are kept
+        // for reuse in buckets of equal sizes, up to SGCL_LARGE_CACHE_SIZE bytes in total
+        struct Large_object_allocator_base : Object_allocator {
+            static constexpr unsigned BucketCount = 128;
+
+            static unsigned bucket_of(size_t size) noexcept {
+                auto pages = (size + PageSize - 1) / PageSize;
+                if (pages < 4) {
+                    return (unsigned)pages;
+                }
+                unsigned exponent = 2;
+                while(pages >> (exponent + 1)) {
+                    ++exponent;
+                }
+                auto step = size_t(1) << (exponent - 2);
+                auto quarter = (pages + step - 1) / step;
+                if (quarter == 8) {
+                    ++exponent;
+                    quarter = 4;
+                }
+                return 4 * (exponent - 1) + (unsigned)(quarter - 4);
+            }
+
+            static size_t bucket_size(unsigned bucket) noexcept {
+                if (bucket < 4) {
+                    return bucket * PageSize;
+                }
+                auto exponent = bucket / 4 + 1;
+                auto quarter = size_t(bucket % 4 + 4);
+                return (quarter << (exponent - 2)) * PageSize;
+            }
+
+            static void* alloc_region(size_t& size, bool& zeroed) {
+                auto bucket = bucket_of(size);
+                if (bucket < BucketCount) {
+                    size = bucket_size(bucket);
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    auto region = _regions[bucket];
+                    if (region) {
+                        _regions[bucket] = *(void**)region;
+                        _cached_size -= size;
+                        zeroed = false;
+                        return region;
+                    }
+                } else {
+                    size = (size + PageSize - 1) & ~(PageSize - 1);
+                }
+#ifdef SGCL_LARGE_MMAP
+                if (size >= SGCL_LARGE_MMAP_THRESHOLD) {
+                    // anonymous pages are zero filled on the first touch
+                    zeroed = true;
+                    return _map(size);
+                }
+#endif
+                zeroed = false;
+                return ::operator new(size, std::align_val_t(PageSize));
+            }
+
+            static void free_region(void* region, size_t size) noexcept {
+                auto bucket = bucket_of(size);
+                if (bucket < BucketCount) {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    if (_cached_size + size <= SGCL_LARGE_CACHE_SIZE) {
+                        *(void**)region = _regions[bucket];
+                        _regions[bucket] = region;
+                        _cached_size += size;
+                        return;
+                    }
+                }
+#ifdef SGCL_LARGE_MMAP
+                if (size >= SGCL_LARGE_MMAP_THRESHOLD) {
+                    munmap(region, size);
+                    return;
+                }
+#endif
+                ::operator delete(region, std::align_val_t(PageSize));
+            }
+
+            // a mapped region is extended without moving it, the size is rounded like in alloc_region()
+            static bool extend_region(void* region, size_t& size, size_t new_size) noexcept {
+#if defined(SGCL_LARGE_MMAP) && defined(__linux__)
+                if (size >= SGCL_LARGE_MMAP_THRESHOLD) {
+                    auto bucket = bucket_of(new_size);
+                    new_size = bucket < BucketCount ? bucket_size(bucket) : (new_size + PageSize - 1) & ~(PageSize - 1);
+                    if (mremap(region, size, new_size, 0) != MAP_FAILED) {
+                        size = new_size;
+                        return true;
+                    }
+                }
+#else
+                std::ignore = region;
+                std::ignore = size;
+                std::ignore = new_size;
+#endif
+                return false;
+            }
+
+        private:
+#ifdef SGCL_LARGE_MMAP
+            static void* _map(size_t size) {
+                auto mapped_size = size + (PageSize > 4096 ? PageSize : 0);
+                auto mem = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (mem == MAP_FAILED) {
+                    throw std::bad_alloc();
+                }
+                auto region = ((uintptr_t)mem + PageSize - 1) & ~(PageSize - 1);
+                if (region > (uintptr_t)mem) {
+                    munmap(mem, region - (uintptr_t)mem);
+                }
+                if ((uintptr_t)mem + mapped_size > region + size) {
+                    munmap((void*)(region + size), (uintptr_t)mem + mapped_size - region - size);
+                }
+                return (void*)region;
+            }
+#endif
+
+            inline static std::mutex _mutex;
+            inline static std::array<void*, BucketCount> _regions = {};
+            inline static size_t _cached_size = {0};
+        };
+
         template<class T>
-        struct Large_object_allocator : Object_allocator {
+        struct Large_object_allocator : Large_object_allocator_base {
             using Type = typename Type_info<T>::type;
 
             Type* alloc(size_t size) const {
-                auto mem = ::operator new(size + sizeof(Type) + sizeof(uintptr_t), std::align_val_t(PageSize));
+#if SGCL_LATENCY_HISTOGRAMS
+                Latency_scope latency(latency_event::large_alloc);
+#endif
+                size += sizeof(Type) + sizeof(uintptr_t);
+                bool zeroed;
+                auto mem = alloc_region(size, zeroed);
                 auto data = (Type*)((uintptr_t)mem + sizeof(uintptr_t));
-                auto hmem = ::operator new(Type_info<T>::HeaderSize);
-                auto page = new(hmem) Page(nullptr, data);
+                auto page = Page::create(nullptr, data);
+                page->region_size = size;
+                page->zeroed = zeroed;
                 *((Page**)mem) = page;
-                page->next = pages.load(std::memory_order_relaxed);
-                while(!pages.compare_exchange_weak(page->next, page, std::memory_order_release, std::memory_order_relaxed));
                 return data;
             }
 
+            // the object takes the rest of its region, or the region is extended in place
+            static bool grow(Type* p, size_t size) noexcept {
+                auto page = Page::page_of(p);
+                size += sizeof(Type) + sizeof(uintptr_t);
+                if (size <= page->region_size) {
+                    return true;
+                }
+                return extend_region((void*)(page->data - sizeof(uintptr_t)), page->region_size, size);
+            }
+
             static void free(Page* pages) noexcept {
                 Page* page = pages;
                 while(page) {
                     auto data = (void*)(page->data - sizeof(uintptr_t));
-                    ::operator delete(data, std::align_val_t(PageSize));
+                    free_region(data, page->region_size);
                     page->is_used = false;
                     page = page->next_empty;
                 }
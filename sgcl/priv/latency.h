@@ -0,0 +1,76 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "../latency_histogram.h"
+#include "timer.h"
+
+#include <atomic>
+
+namespace sgcl {
+    namespace Priv {
+        // the buckets are counted without locks, a snapshot taken during recording can be off by the pending values
+        struct Latency_histogram {
+            static constexpr unsigned EventCount = (unsigned)latency_event::forced_collect_wait + 1;
+
+            void record(uint64_t ns) noexcept {
+                _counts[latency_histogram::bucket_of(ns)].fetch_add(1, std::memory_order_relaxed);
+                _count.fetch_add(1, std::memory_order_relaxed);
+                _total.fetch_add(ns, std::memory_order_relaxed);
+                auto max = _max.load(std::memory_order_relaxed);
+                while (ns > max && !_max.compare_exchange_weak(max, ns, std::memory_order_relaxed));
+            }
+
+            latency_histogram snapshot() const noexcept {
+                latency_histogram histogram;
+                for (unsigned i = 0; i < latency_histogram::BucketCount; ++i) {
+                    histogram.counts[i] = _counts[i].load(std::memory_order_relaxed);
+                }
+                histogram.count = _count.load(std::memory_order_relaxed);
+                histogram.total = _total.load(std::memory_order_relaxed);
+                histogram.max = _max.load(std::memory_order_relaxed);
+                return histogram;
+            }
+
+            void reset() noexcept {
+                for (auto& count : _counts) {
+                    count.store(0, std::memory_order_relaxed);
+                }
+                _count.store(0, std::memory_order_relaxed);
+                _total.store(0, std::memory_order_relaxed);
+                _max.store(0, std::memory_order_relaxed);
+            }
+
+            static Latency_histogram& of(latency_event event) noexcept {
+                static Latency_histogram histograms[EventCount];
+                return histograms[(unsigned)event];
+            }
+
+        private:
+            std::atomic<uint64_t> _counts[latency_histogram::BucketCount] = {};
+            std::atomic<uint64_t> _count = {0};
+            std::atomic<uint64_t> _total = {0};
+            std::atomic<uint64_t> _max = {0};
+        };
+
+        // records the time from its construction to its destruction
+        struct Latency_scope {
+            Latency_scope(latency_event event) noexcept
+            : _event(event)
+            , _start(Timer::now()) {
+            }
+
+            ~Latency_scope() noexcept {
+                auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Timer::now() - _start).count();
+                Latency_histogram::of(_event).record((uint64_t)ns);
+            }
+
+        private:
+            const latency_event _event;
+            const std::chrono::steady_clock::time_point _start;
+        };
+    }
+}
@@ -8,12 +8,11 @@
 #include "array.h"
 #include "unique_ptr.h"
 
+#include <cassert>
 #include <cstring>
 
 namespace sgcl {
     namespace Priv {
-        void Collector_init();
-
         template<class T, class ...A>
         inline T* Construct(void* p, A&&... a) {
             Page::set_state(p, State::UniqueLock);
@@ -37,27 +36,77 @@ namespace sgcl {
                 return _make(std::forward<A>(a)...);
             }
 
+            // the thread, the allocator and the counters are looked up once for all objects
+            template<class O, class ...A>
+            static O make_tracked_n(size_t count, O out, const A&... a) {
+                if (count && !Info::child_pointers.final.load(std::memory_order_acquire)) {
+                    *out++ = _make(a...);
+                    --count;
+                }
+                if (!count) {
+                    return out;
+                }
+                auto& thread = Current_thread();
+                auto& allocator = thread.alocator<typename Info::Allocation_type>();
+                size_t made = 0;
+                try {
+                    for (; made < count; ++made) {
+                        auto mem = allocator.alloc();
+                        if constexpr(Info::SizeClass) {
+                            auto page = Page::page_of(mem);
+                            page->types[page->index_of(mem)] = &Info::private_metadata();
+                        }
+                        if constexpr(!SGCL_ZEROED_SLOTS) {
+                            std::memset(mem, 0, sizeof(T));
+                        }
+                        auto ptr = Construct<Type>(mem, a...);
+#if SGCL_PROFILER
+                        Profiler::allocated(thread.profiler_countdown, ptr, typeid(T), sizeof(T));
+#endif
+                        *out++ = Unique_ptr<T>(ptr);
+                    }
+                } catch (...) {
+                    thread.update_allocated(sizeof(T) * made, made);
+                    throw;
+                }
+                thread.update_allocated(sizeof(T) * made, made);
+                return out;
+            }
+
         private:
             using Info = Type_info<T>;
             using Type = typename Info::type;
 
             template<class ...A>
             static Unique_ptr<T> _make(A&&... a) {
-                Collector_init();
-                auto& thread = Current_thread();
-                auto& allocator = thread.alocator<Type>();
+                Thread::Data* data;
+                auto& allocator = Current_allocator<typename Info::Allocation_type>(data);
                 auto mem = allocator.alloc();
+                if constexpr(Info::SizeClass) {
+                    auto page = Page::page_of(mem);
+                    page->types[page->index_of(mem)] = &Info::private_metadata();
+                }
                 Type* ptr;
                 if (!Info::child_pointers.final.load(std::memory_order_acquire)) {
                     std::memset(mem, 0xFF, sizeof(T));
-                    auto range_guard = thread.use_child_pointers({(uintptr_t)mem, &Info::child_pointers.map});
+                    auto range_guard = Current_thread().use_child_pointers({(uintptr_t)mem, &Info::child_pointers.map});
                     ptr = Construct<Type>(mem, std::forward<A>(a)...);
+                    assert(Info::child_pointers.map_matches_offsets() && "[sgcl] SGCL_TRACE does not list all tracked pointers");
                     Info::child_pointers.final.store(true, std::memory_order_release);
                 } else {
-                    std::memset(mem, 0, sizeof(T));
+                    if constexpr(Info::ObjectSize <= PageDataSize) {
+                        if constexpr(!SGCL_ZEROED_SLOTS) {
+                            std::memset(mem, 0, sizeof(T));
+                        }
+                    } else if (!Page::is_zeroed(mem)) {
+                        std::memset(mem, 0, sizeof(T));
+                    }
                     ptr = Construct<Type>(mem, std::forward<A>(a)...);
                 }
-                thread.update_allocated(sizeof(T));
+                data->update_allocated(sizeof(T));
+#if SGCL_PROFILER
+                Profiler::allocated(Current_thread().profiler_countdown, ptr, typeid(T), sizeof(T));
+#endif
                 return Unique_ptr<T>(ptr);
             }
         };
@@ -67,12 +116,18 @@ namespace sgcl {
             static Unique_ptr<void> _make(size_t size, size_t count) {
                 using Info = Type_info<T>;
                 using Type = typename Info::type;
-                Collector_init();
-                auto& thread = Current_thread();
-                auto& allocator = thread.alocator<Type>();
+                Thread::Data* data;
+                auto& allocator = Current_allocator<Type>(data);
                 auto mem = allocator.alloc(size);
+                // the header can be read by the collector once the state is set,
+                // the metadata has to read as null until Construct publishes it
+                if (!Page::is_zeroed(mem)) {
+                    auto header = (Array_base*)mem;
+                    header->metadata.store(nullptr, std::memory_order_relaxed);
+                    header->count.store(0, std::memory_order_relaxed);
+                }
                 auto ptr = Construct<Type>(mem, count);
-                thread.update_allocated(sizeof(Type) + size);
+                data->update_allocated(sizeof(Type) + size);
                 return Unique_ptr<void>(ptr->data);
             }
 
@@ -101,6 +156,7 @@ namespace sgcl {
                     auto p = _make_array<>(count, sizeof(T));
                     auto array = (Array<>*)((Array_base*)p.get() - 1);
                     _init_data(*array);
+                    _sample(*array);
                     return Unique_ptr<T[]>((T*)p.release());
                 }
                 return nullptr;
@@ -112,6 +168,19 @@ namespace sgcl {
                     auto p = _make_array<>(count, sizeof(T));
                     auto array = (Array<>*)((Array_base*)p.get() - 1);
                     _init_data(*array, std::forward<A>(a)...);
+                    _sample(*array);
+                    return Unique_ptr<T[]>((T*)p.release());
+                }
+                return nullptr;
+            }
+
+            // the memory of elements is not cleared if they hold no tracked pointers
+            static Unique_ptr<T[]> make_tracked_for_overwrite(size_t count) {
+                if (count) {
+                    auto p = _make_array<>(count, sizeof(T));
+                    auto array = (Array<>*)((Array_base*)p.get() - 1);
+                    _init_data<true>(*array);
+                    _sample(*array);
                     return Unique_ptr<T[]>((T*)p.release());
                 }
                 return nullptr;
@@ -122,11 +191,37 @@ namespace sgcl {
                     auto p = _make_array<>(l.size(), sizeof(T));
                     auto array = (Array<>*)((Array_base*)p.get() - 1);
                     _init_data(*array, l);
+                    _sample(*array);
                     return Unique_ptr<T[]>((T*)p.release());
                 }
                 return nullptr;
             }
 
+            // new elements are added to a large array in its region or by extending the mapping
+            // of the region, they are initialized like by make_tracked(count)
+            static bool grow(T* data, size_t count) {
+                auto array = (Array<>*)((Array_base*)data - 1);
+                auto page = Page::page_of(array);
+                auto size = array->count.load(std::memory_order_relaxed);
+                if (page->block || count <= size) {
+                    return false;
+                }
+                if (!Large_object_allocator<Array<>>::grow(array, sizeof(Type) * count + sizeof(Array_base) - sizeof(Array<>))) {
+                    return false;
+                }
+                if constexpr(!std::is_trivial_v<Type>) {
+                    if (!page->zeroed) {
+                        std::memset((Type*)data + size, 0, sizeof(Type) * (count - size));
+                    }
+                    if constexpr(!std::is_base_of_v<Tracked, Type>) {
+                        _init(data, size, count);
+                    }
+                }
+                array->count.store(count, std::memory_order_release);
+                Current_thread().update_allocated(sizeof(Type) * (count - size), 0);
+                return true;
+            }
+
         private:
             using Info = Type_info<T>;
             using Type = typename Info::type;
@@ -152,20 +247,33 @@ namespace sgcl {
                 }
             }
 
-            template<class... A>
+            static void _sample(const Array<>& array) {
+#if SGCL_PROFILER
+                Profiler::allocated(Current_thread().profiler_countdown, &array, typeid(T[]), sizeof(Array_base) + sizeof(T) * array.count);
+#else
+                std::ignore = array;
+#endif
+            }
+
+            template<bool Overwrite = false, class... A>
             static void _init_data(Array<>& array, A&&... a) {
                 if constexpr(!std::is_trivial_v<Type>) {
                     int offset;
                     if (!Info::child_pointers.final.load(std::memory_order_acquire)) {
                         std::memset(array.data, 0xFF, sizeof(Type));
-                        std::memset((Type*)array.data + 1, 0, sizeof(Type) * (array.count - 1));
+                        if (!Page::is_zeroed(&array)) {
+                            std::memset((Type*)array.data + 1, 0, sizeof(Type) * (array.count - 1));
+                        }
                         array.metadata.store(&Info::array_metadata(), std::memory_order_release);
                         auto range_guard = Current_thread().use_child_pointers({(uintptr_t)array.data, &Info::child_pointers.map});
                         _init(array.data, 0, 1, std::forward<A>(a)...);
+                        assert(Info::child_pointers.map_matches_offsets() && "[sgcl] SGCL_TRACE does not list all tracked pointers");
                         Info::child_pointers.final.store(true, std::memory_order_release);
                         offset = 1;
                     } else {
-                        std::memset(array.data, 0, sizeof(Type) * array.count);
+                        if (!Page::is_zeroed(&array) && (!Overwrite || !Info::child_pointers.is_empty())) {
+                            std::memset(array.data, 0, sizeof(Type) * array.count);
+                        }
                         array.metadata.store(&Info::array_metadata(), std::memory_order_release);
                         offset = 0;
                     }
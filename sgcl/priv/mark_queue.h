@@ -0,0 +1,48 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "types.h"
+
+#include <deque>
+#include <mutex>
+
+namespace sgcl {
+    namespace Priv {
+        // every marker has its own queue, so the mutex is contended only by stealing;
+        // a marker preempted while holding it does not make the others spin
+        struct Mark_queue {
+            void push(Page* page) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _pages.push_back(page);
+            }
+
+            Page* pop() noexcept {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (_pages.empty()) {
+                    return nullptr;
+                }
+                auto page = _pages.back();
+                _pages.pop_back();
+                return page;
+            }
+
+            Page* steal() noexcept {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (_pages.empty()) {
+                    return nullptr;
+                }
+                auto page = _pages.front();
+                _pages.pop_front();
+                return page;
+            }
+
+        private:
+            std::mutex _mutex;
+            std::deque<Page*> _pages;
+        };
+    }
+}
@@ -0,0 +1,109 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "page.h"
+
+#include <vector>
+
+namespace sgcl {
+    namespace Priv {
+        inline void Prefetch(const void* p) noexcept {
+#if defined(__GNUC__)
+            __builtin_prefetch(p);
+#else
+            (void)p;
+#endif
+        }
+
+        // the pointers of objects to mark, checked a few entries after they are popped: the page
+        // header of a pointer is prefetched first, then its flags and the object, so the cache
+        // misses of a pointer chase overlap instead of following each other
+        struct Mark_stack {
+            static constexpr unsigned Distance = 8;
+
+            void push(const void* p) {
+                Prefetch((const void*)((uintptr_t)p & ~(uintptr_t)(PageSize - 1)));
+                _pointers.push_back(p);
+            }
+
+            bool empty() const noexcept {
+                return _pointers.empty() && !_headers.count && !_objects.count;
+            }
+
+            // f(page, index) is called for each pointer and may push new ones; returns false
+            // if the deadline stopped draining, the pointers left are kept
+            template<class F, class D>
+            bool drain(F&& f, D& deadline) {
+                unsigned steps = 0;
+                for (;;) {
+                    if (!_pointers.empty() && !_headers.full()) {
+                        auto p = _pointers.back();
+                        _pointers.pop_back();
+                        auto page = Page::page_of(p);
+                        Prefetch(page);
+                        _headers.push({p, page});
+                        continue;
+                    }
+                    if (_headers.count && !_objects.full()) {
+                        auto header = _headers.pop();
+                        auto page = header.page;
+                        auto index = page->index_of(header.pointer);
+                        Prefetch(&page->flags()[Page::flag_index_of(index)]);
+                        Prefetch(page->pointer_of(index));
+                        _objects.push({page, index});
+                        continue;
+                    }
+                    if (!_objects.count) {
+                        return true;
+                    }
+                    auto object = _objects.pop();
+                    f(object.page, object.index);
+                    if (!(++steps % 256) && deadline()) {
+                        return false;
+                    }
+                }
+            }
+
+        private:
+            struct Header {
+                const void* pointer;
+                Page* page;
+            };
+
+            struct Object {
+                Page* page;
+                unsigned index;
+            };
+
+            template<class T>
+            struct Ring {
+                bool full() const noexcept {
+                    return count == Distance;
+                }
+
+                void push(const T& value) noexcept {
+                    values[(first + count++) % Distance] = value;
+                }
+
+                T pop() noexcept {
+                    auto& value = values[first];
+                    first = (first + 1) % Distance;
+                    --count;
+                    return value;
+                }
+
+                T values[Distance];
+                unsigned first = {0};
+                unsigned count = {0};
+            };
+
+            std::vector<const void*> _pointers;
+            Ring<Header> _headers;
+            Ring<Object> _objects;
+        };
+    }
+}
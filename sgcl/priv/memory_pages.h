@@ -0,0 +1,139 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "thread.h"
+
+#include <array>
+#include <mutex>
+
+namespace sgcl {
+    namespace Priv {
+        struct Memory_block {
+            Memory_block* next;
+        };
+
+        struct Memory_list {
+            Memory_block* blocks = {nullptr};
+            unsigned count = {0};
+        };
+
+        struct Shared_memory_list {
+            std::mutex mutex;
+            Memory_block* blocks = {nullptr};
+        };
+
+        // untracked blocks of power of two sizes carved from data pages of the thread block allocators,
+        // a block is aligned to its size, so the first one of a page is left for the block pointer;
+        // the freed blocks are cached by threads and the surplus is shared, pages are kept for their size
+        struct Memory_pages {
+            static constexpr unsigned ClassCount = 6;
+            static constexpr size_t MinSize = 16;
+            static constexpr size_t MaxSize = MinSize << (ClassCount - 1);
+            // the number of blocks moved between a thread and the shared lists at once
+            static constexpr unsigned BatchSize = 32;
+
+            static unsigned class_of(size_t size) noexcept {
+                unsigned index = 0;
+                while((MinSize << index) < size) {
+                    ++index;
+                }
+                return index;
+            }
+
+            static void* alloc(unsigned index) {
+                return _cache.alloc(index);
+            }
+
+            static void free(void* p, unsigned index) noexcept {
+                _cache.free(p, index);
+            }
+
+        private:
+            struct Cache {
+                ~Cache() noexcept {
+                    for (unsigned index = 0; index < ClassCount; ++index) {
+                        auto& list = _lists[index];
+                        if (list.blocks) {
+                            auto last = list.blocks;
+                            while(last->next) {
+                                last = last->next;
+                            }
+                            _share(index, list.blocks, last);
+                        }
+                    }
+                }
+
+                void* alloc(unsigned index) {
+                    auto& list = _lists[index];
+                    if (!list.blocks) {
+                        _refill(index);
+                    }
+                    auto block = list.blocks;
+                    list.blocks = block->next;
+                    --list.count;
+                    return block;
+                }
+
+                void free(void* p, unsigned index) noexcept {
+                    auto& list = _lists[index];
+                    auto block = (Memory_block*)p;
+                    block->next = list.blocks;
+                    list.blocks = block;
+                    if (++list.count >= BatchSize * 2) {
+                        auto last = block;
+                        for (unsigned i = 1; i < BatchSize; ++i) {
+                            last = last->next;
+                        }
+                        list.blocks = last->next;
+                        list.count -= BatchSize;
+                        _share(index, block, last);
+                    }
+                }
+
+            private:
+                std::array<Memory_list, ClassCount> _lists;
+
+                // a batch of the shared blocks or a new page
+                void _refill(unsigned index) {
+                    auto& list = _lists[index];
+                    auto& shared = _shared[index];
+                    {
+                        std::lock_guard<std::mutex> lock(shared.mutex);
+                        auto block = shared.blocks;
+                        for (; block && list.count < BatchSize; ++list.count) {
+                            auto next = block->next;
+                            block->next = list.blocks;
+                            list.blocks = block;
+                            block = next;
+                        }
+                        shared.blocks = block;
+                    }
+                    if (!list.blocks) {
+                        bool zeroed;
+                        auto page = (uintptr_t)Current_thread().block_allocator().alloc(zeroed);
+                        auto size = MinSize << index;
+                        for (auto offset = PageSize - size; offset >= size; offset -= size, ++list.count) {
+                            auto block = (Memory_block*)(page + offset);
+                            block->next = list.blocks;
+                            list.blocks = block;
+                        }
+                    }
+                }
+
+                static void _share(unsigned index, Memory_block* first, Memory_block* last) noexcept {
+                    auto& shared = _shared[index];
+                    std::lock_guard<std::mutex> lock(shared.mutex);
+                    last->next = shared.blocks;
+                    shared.blocks = first;
+                }
+            };
+
+            inline static std::array<Shared_memory_list, ClassCount> _shared;
+            inline static thread_local Cache _cache;
+        };
+    }
+}
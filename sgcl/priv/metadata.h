@@ -8,6 +8,7 @@
 #include "../configuration.h"
 #include "array_base.h"
 #include "child_pointers.h"
+#include "page_headers.h"
 
 namespace sgcl {
     namespace Priv {
@@ -23,6 +24,7 @@ namespace sgcl {
                 : child_pointers(Info<T>::child_pointers)
                 , destroy(!std::is_trivially_destructible_v<T> || std::is_base_of_v<Array_base, T> ? Info<T>::destroy : nullptr)
                 , free(Info<T>::Object_allocator::free)
+                , free_header(Page_headers<Info<T>::HeaderSize>::free)
                 , clone(Clone<T>)
                 , object_size(Info<T>::ObjectSize)
                 , object_count(Info<T>::ObjectCount)
@@ -34,6 +36,7 @@ namespace sgcl {
             Child_pointers& child_pointers;
             void (*const destroy)(void*) noexcept;
             void (*const free)(Page*);
+            void (*const free_header)(void*) noexcept;
             void* (*const clone)(const void*);
             const size_t object_size;
             const unsigned object_count;
@@ -11,7 +11,6 @@ namespace sgcl {
     namespace Priv {
         struct Object_allocator {
             virtual ~Object_allocator() noexcept = default;
-            inline static std::atomic<Page*> pages = {nullptr};
         };
     }
 }
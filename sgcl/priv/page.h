@@ -5,6 +5,7 @@
 //------------------------------------------------------------------------------
 #pragma once
 
+#include "../configuration.h"
 #include "data_page.h"
 #include "metadata.h"
 
@@ -13,17 +14,32 @@
 
 namespace sgcl {
     namespace Priv {
+        struct Pool_buffer;
+
         struct Page {
             template<class T>
             using Info = Type_info<T>;
 
             using Flag = uint64_t;
+
+            // the pages of arena scopes and page pools are not shared with other allocators, see arena_scope and page_pool
+            enum class Arena : uint8_t {
+                None,
+                Active,
+                Ended,
+                Pool
+            };
             static constexpr unsigned FlagBitCount = sizeof(Flag) * 8;
 
             struct Flags {
                 Flag registered = {0};
-                Flag reachable = {0};
-                Flag marked = {0};
+                std::atomic<Flag> reachable = {0};
+                std::atomic<Flag> marked = {0};
+#if SGCL_GENERATIONAL
+                std::atomic<Flag> old = {0};
+                Flag survived = {0};
+                Flag remembered = {0};
+#endif
             };
 
             template<class T>
@@ -31,7 +47,9 @@ namespace sgcl {
                 : metadata(&Info<T>::private_metadata())
                 , block(block)
                 , data((uintptr_t)data)
-                , multiplier((1ull << 32 | 0x10000) / metadata->object_size) {
+                , multiplier((1ull << 32 | 0x10000) / metadata->object_size)
+                , types(Info<T>::TypesSize ? (Metadata**)((uintptr_t)(this + 1) + Info<T>::StatesSize + Info<T>::FlagsSize) : nullptr)
+                , flags_data((Flags*)((uintptr_t)(this + 1) + Info<T>::StatesSize)) {
                 assert(metadata != nullptr);
                 assert(data != nullptr);
                 std::memset(this->states(), State::Reserved, metadata->object_count);
@@ -45,13 +63,25 @@ namespace sgcl {
                 }
             }
 
+            // the header is taken from the headers of its type size, see Page_headers
+            template<class T>
+            static Page* create(Block* block, T* data) {
+                auto mem = Page_headers<Info<T>::HeaderSize>::alloc();
+                return new(mem) Page(block, data);
+            }
+
+            static void destroy(Page* page) noexcept {
+                auto free_header = page->metadata->free_header;
+                page->~Page();
+                free_header(page);
+            }
+
             std::atomic<State>* states() const noexcept {
                 return (std::atomic<State>*)(this + 1);
             }
 
             Flags* flags() const noexcept {
-                auto states_size = (sizeof(std::atomic<State>) * metadata->object_count + sizeof(uintptr_t) - 1) & ~(sizeof(uintptr_t) - 1);
-                return (Flags*)((uintptr_t)states() + states_size);
+                return flags_data;
             }
 
             unsigned flags_count() const noexcept {
@@ -62,11 +92,22 @@ namespace sgcl {
                 auto flags = this->flags();
                 auto count = flags_count();
                 for (unsigned i = 0; i < count; ++i) {
-                    flags[i].reachable = 0;
-                    flags[i].marked = 0;
+                    flags[i].reachable.store(0, std::memory_order_relaxed);
+                    flags[i].marked.store(0, std::memory_order_relaxed);
                 }
             }
 
+#if SGCL_GENERATIONAL
+            // old objects are not traced in minor cycles
+            void mark_old() noexcept {
+                auto flags = this->flags();
+                auto count = flags_count();
+                for (unsigned i = 0; i < count; ++i) {
+                    flags[i].marked.store(flags[i].old.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                }
+            }
+#endif
+
             static constexpr unsigned flag_index_of(unsigned i) noexcept {
                 return i / FlagBitCount;
             }
@@ -90,10 +131,15 @@ namespace sgcl {
                 return *((Page**)page);
             }
 
+            // objects on size class pages have their own metadata, see Size_class
+            Metadata& object_metadata(unsigned index) const noexcept {
+                return types ? *types[index] : *metadata;
+            }
+
             static Metadata& metadata_of(const void* p) noexcept {
                 assert(p != nullptr);
                 auto page = Page::page_of(p);
-                return *page->metadata;
+                return page->object_metadata(page->index_of(p));
             }
 
             static void* base_address_of(const void* p) noexcept {
@@ -108,7 +154,11 @@ namespace sgcl {
                 auto page = Page::page_of(p);
                 auto index = page->index_of(p);
                 auto &state = page->states()[index];
-                state.store(s, std::memory_order_release);
+                // readers of a shared atomic pointer do not write to the cache line of a set state
+                if (state.load(std::memory_order_relaxed) != s) {
+                    state.store(s, std::memory_order_release);
+                    page->set_dirty();
+                }
             }
 
             static void update_state(const void* p, State s) noexcept {
@@ -118,6 +168,50 @@ namespace sgcl {
                 auto &state = page->states()[index];
                 if (s > state.load(std::memory_order_acquire)) {
                     state.store(s, std::memory_order_release);
+                    page->set_dirty();
+                }
+            }
+
+            // the exchange pairs with the one in the collector, a page is either
+            // visited after the state change or pushed to the dirty list again
+            void set_dirty() noexcept {
+                if (!dirty.exchange(true, std::memory_order_acq_rel)) {
+                    next_dirty = dirty_pages.load(std::memory_order_relaxed);
+                    while(!dirty_pages.compare_exchange_weak(next_dirty, this, std::memory_order_release, std::memory_order_relaxed));
+                }
+            }
+
+#if SGCL_GENERATIONAL
+            static bool is_young(const void* p) noexcept {
+                assert(p != nullptr);
+                auto page = Page::page_of(p);
+                auto index = page->index_of(p);
+                auto& flag = page->flags()[flag_index_of(index)];
+                return !(flag.old.load(std::memory_order_relaxed) & flag_mask_of(index));
+            }
+#endif
+
+            // objects allocated during a cycle are not registered, they are not swept by it
+            static bool is_marked(const void* p) noexcept {
+                assert(p != nullptr);
+                auto page = Page::page_of(p);
+                auto index = page->index_of(p);
+                auto& flag = page->flags()[flag_index_of(index)];
+                auto mask = flag_mask_of(index);
+                return !(flag.registered & mask) || (flag.marked.load(std::memory_order_acquire) & mask);
+            }
+
+            // memory of large objects fresh from the OS and the unused places of small objects
+            // do not have to be cleared, see SGCL_ZEROED_SLOTS
+            static bool is_zeroed(const void* p) noexcept {
+                assert(p != nullptr);
+                return Page::page_of(p)->zeroed;
+            }
+
+            // clears a freed place of a small object, large objects are not reused
+            void clear(unsigned index) noexcept {
+                if (block && zeroed) {
+                    std::memset(pointer_of(index), 0, metadata->object_size);
                 }
             }
 
@@ -133,17 +227,31 @@ namespace sgcl {
             Block* const block;
             const uintptr_t data;
             const uint64_t multiplier;
-            bool reachable = {false};
+            Metadata** const types;
+            // the fields used by marking fill the first cache line of the header, see Page_headers
+            Flags* const flags_data;
+            size_t region_size = {0};
+            std::atomic_bool reachable = {false};
             bool unreachable = {false};
             bool registered = {false};
+            // the page may have unused places, see Collector::_release_unused_pages()
+            bool release_candidate = {false};
             bool is_used = {true};
+            bool zeroed = {false};
             std::atomic_bool on_empty_list = {false};
+            std::atomic_bool dirty = {false};
+            Arena arena = {Arena::None};
+            Page* next_arena = {nullptr};
+            Pool_buffer* pool_buffer = {nullptr};
+#if SGCL_PROFILER
+            std::atomic<unsigned> sampled = {0};
+#endif
             Page* next_reachable = {nullptr};
             Page* next_unreachable = {nullptr};
             Page* next_registered = {nullptr};
             Page* next_empty = {nullptr};
-            Page* next_unused = {nullptr};
-            Page* next = {nullptr};
+            Page* next_dirty = {nullptr};
+            inline static std::atomic<Page*> dirty_pages = {nullptr};
         };
     }
 }
@@ -0,0 +1,58 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+namespace sgcl {
+    namespace Priv {
+        // the page headers of one size are carved from chunks, so they lie densely on cache line
+        // boundaries without the overhead of the C++ heap; freed headers are reused by new pages,
+        // the chunks are kept; a header is taken once per page, so a lock is cheap enough
+        template<size_t Size>
+        struct Page_headers {
+            static constexpr size_t CacheLineSize = 64;
+            static constexpr size_t HeaderSize = (Size + CacheLineSize - 1) & ~(CacheLineSize - 1);
+            static constexpr size_t ChunkCount = 16;
+
+            static void* alloc() {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (_free_headers) {
+                    auto header = _free_headers;
+                    _free_headers = header->next;
+                    return header;
+                }
+                if (_position == _end) {
+                    _position = (uintptr_t)::operator new(HeaderSize * ChunkCount, std::align_val_t(CacheLineSize));
+                    _end = _position + HeaderSize * ChunkCount;
+                }
+                auto header = (void*)_position;
+                _position += HeaderSize;
+                return header;
+            }
+
+            static void free(void* p) noexcept {
+                std::lock_guard<std::mutex> lock(_mutex);
+                auto header = (Free_header*)p;
+                header->next = _free_headers;
+                _free_headers = header;
+            }
+
+        private:
+            struct Free_header {
+                Free_header* next;
+            };
+
+            inline static std::mutex _mutex;
+            inline static Free_header* _free_headers = {nullptr};
+            inline static uintptr_t _position = {0};
+            inline static uintptr_t _end = {0};
+        };
+    }
+}
@@ -9,12 +9,25 @@
 #include "array_metadata.h"
 #include "data_page.h"
 #include "page.h"
+#include "trace.h"
 #include "types.h"
 
 namespace sgcl {   
     namespace Priv {
         inline static metadata void_mdata;
 
+        // the storage of small objects that share pages with other types of the same size
+        template<size_t Size>
+        struct Size_class {
+            char data[Size];
+        };
+
+        template<class>
+        struct Is_size_class : std::false_type {};
+
+        template<size_t Size>
+        struct Is_size_class<Size_class<Size>> : std::true_type {};
+
         template<class T>
         struct Page_info {
             using Type = std::remove_cv_t<T>;
@@ -23,8 +36,12 @@ namespace sgcl {
             static constexpr size_t StatesSize = (sizeof(std::atomic<State>) * ObjectCount + sizeof(uintptr_t) - 1) & ~(sizeof(uintptr_t) - 1);
             static constexpr size_t FlagsCount = (ObjectCount + Page::FlagBitCount - 1) / Page::FlagBitCount;
             static constexpr size_t FlagsSize = sizeof(Page::Flags) * FlagsCount;
-            static constexpr size_t HeaderSize = sizeof(Page) + StatesSize + FlagsSize;
+            static constexpr size_t TypesSize = Is_size_class<Type>::value ? sizeof(Metadata*) * ObjectCount : 0;
+            static constexpr size_t HeaderSize = sizeof(Page) + StatesSize + FlagsSize + TypesSize;
             using Object_allocator = std::conditional_t<ObjectSize <= PageDataSize, Small_object_allocator<Type>, Large_object_allocator<Type>>;
+            static constexpr bool SizeClass = SGCL_SIZE_CLASSES && ObjectSize <= PageDataSize && alignof(std::conditional_t<std::is_same_v<Type, void>, char, Type>) <= alignof(uintptr_t)
+                && !std::is_same_v<Type, void> && !std::is_array_v<Type> && !std::is_base_of_v<Array_base, Type> && !Is_size_class<Type>::value;
+            using Allocation_type = std::conditional_t<SizeClass, Size_class<ObjectSize>, Type>;
 
             static void destroy(void* p) noexcept {
                 std::destroy_at((T*)p);
@@ -50,7 +67,25 @@ namespace sgcl {
                 return *metadata;
             }
 
-            inline static Child_pointers child_pointers {std::is_base_of_v<Array_base, Type> || std::is_trivial_v<Type>};
+            static constexpr bool Traced = Is_traced<std::remove_extent_t<Type>>::value;
+
+            static constexpr auto traced_offsets() noexcept {
+                if constexpr(Traced) {
+                    return std::remove_extent_t<Type>::sgcl_child_offsets();
+                } else {
+                    return std::array<ptrdiff_t, 0>{};
+                }
+            }
+
+            static constexpr auto TracedOffsets = traced_offsets();
+            inline static const Child_pointers::Offsets traced_offsets_view = {TracedOffsets.data(), TracedOffsets.size()};
+
+            // debug builds still scan the first object, to check the declared offsets
+            inline static Child_pointers child_pointers {std::is_base_of_v<Array_base, Type> || std::is_trivial_v<Type>
+#if defined(NDEBUG) && !defined(SGCL_DEBUG)
+                || Traced
+#endif
+                , Traced ? &traced_offsets_view : nullptr};
         };
     }
 }
@@ -0,0 +1,78 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "metadata.h"
+#include "page.h"
+#include "page_stack.h"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace sgcl {
+    namespace Priv {
+        struct Page_pool;
+
+        // the pages of a type in a pool with unused places, see Small_object_allocator_base
+        struct Pool_buffer {
+            Pool_buffer(Page_pool& p) noexcept
+            : pool(p) {
+            }
+
+            Page_pool& pool;
+            Page_stack pages;
+            // used by the collector only
+            Page* empty_page = {nullptr};
+            Pool_buffer* next = {nullptr};
+        };
+
+        // the pages of a pool are not shared with other allocators, see sgcl::page_pool; the pool
+        // is deleted by the collector after it ends, its pages are freed like the pages of an arena
+        struct Page_pool {
+            Page_pool() noexcept {
+                next = created_pools.load(std::memory_order_relaxed);
+                while(!created_pools.compare_exchange_weak(next, this, std::memory_order_release, std::memory_order_relaxed));
+            }
+
+            Pool_buffer& buffer(const Metadata& metadata) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                auto& buffer = _buffers[&metadata];
+                if (!buffer) {
+                    buffer.reset(new Pool_buffer(*this));
+                }
+                return *buffer;
+            }
+
+            void add_page(Page* page) noexcept {
+                page->next_arena = new_pages.load(std::memory_order_relaxed);
+                while(!new_pages.compare_exchange_weak(page->next_arena, page, std::memory_order_release, std::memory_order_relaxed));
+            }
+
+            template<class F>
+            void for_each_buffer(F&& f) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                for (auto& [metadata, buffer] : _buffers) {
+                    f(*buffer);
+                }
+            }
+
+            std::atomic<Page*> new_pages = {nullptr};
+            std::atomic<bool> ended = {false};
+            std::atomic<int> scopes = {0};
+            // the pages taken by the collector
+            std::vector<Page*> pages;
+            Page_pool* next = {nullptr};
+            // the pools not yet taken by the collector
+            inline static std::atomic<Page_pool*> created_pools = {nullptr};
+
+        private:
+            std::mutex _mutex;
+            std::unordered_map<const Metadata*, std::unique_ptr<Pool_buffer>> _buffers;
+        };
+    }
+}
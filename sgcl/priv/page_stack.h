@@ -0,0 +1,78 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "page.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+
+namespace sgcl {
+    namespace Priv {
+        // a lock-free stack of pages linked by next_empty; the head keeps a tag in the high bits of
+        // the pointer that changes with every update, so a pop fails if its pages were taken and
+        // pushed again in the meantime; page headers are never unmapped, see Page_headers, so a
+        // stale next_empty read by a failing pop is harmless
+        class Page_stack {
+        public:
+            // the pages from first to last go to the stack at once
+            void push(Page* first, Page* last) noexcept {
+                assert(first && last);
+                auto head = _head.load(std::memory_order_relaxed);
+                do {
+                    last->next_empty = _pointer_of(head);
+                } while(!_head.compare_exchange_weak(head, _tagged(first, head), std::memory_order_release, std::memory_order_relaxed));
+            }
+
+            // pops up to count pages, the rest of the stack stays shared
+            Page* pop(unsigned count) noexcept {
+                auto head = _head.load(std::memory_order_acquire);
+                for (;;) {
+                    auto first = _pointer_of(head);
+                    if (!first) {
+                        return nullptr;
+                    }
+                    auto last = first;
+                    for (unsigned i = 1; i < count && last->next_empty; ++i) {
+                        last = last->next_empty;
+                    }
+                    if (_head.compare_exchange_weak(head, _tagged(last->next_empty, head), std::memory_order_acquire, std::memory_order_acquire)) {
+                        last->next_empty = nullptr;
+                        return first;
+                    }
+                }
+            }
+
+            // takes all pages
+            Page* take() noexcept {
+                auto head = _head.load(std::memory_order_relaxed);
+                while(_pointer_of(head) && !_head.compare_exchange_weak(head, _tagged(nullptr, head), std::memory_order_acquire, std::memory_order_relaxed));
+                return _pointer_of(head);
+            }
+
+            // the first page, for the collector only when no allocator uses the stack
+            Page* top() const noexcept {
+                return _pointer_of(_head.load(std::memory_order_acquire));
+            }
+
+        private:
+            static constexpr unsigned PointerBits = 48;
+            static constexpr uint64_t PointerMask = (uint64_t(1) << PointerBits) - 1;
+
+            static Page* _pointer_of(uint64_t head) noexcept {
+                return (Page*)(uintptr_t)(head & PointerMask);
+            }
+
+            static uint64_t _tagged(Page* page, uint64_t head) noexcept {
+                assert(((uint64_t)(uintptr_t)page & ~PointerMask) == 0);
+                return ((head & ~PointerMask) + (PointerMask + 1)) | (uint64_t)(uintptr_t)page;
+            }
+
+            std::atomic<uint64_t> _head = {0};
+        };
+    }
+}
@@ -0,0 +1,62 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "../collector_tracer.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace sgcl {
+    namespace Priv {
+        // without SGCL_TRACING the calls are empty; a new tracer is taken at the start of a cycle
+        struct Phase_tracer {
+            static constexpr bool Enabled = SGCL_TRACING;
+
+            void set(std::shared_ptr<collector_tracer> tracer) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _new_tracer = std::move(tracer);
+                _changed.store(true, std::memory_order_release);
+            }
+
+            void update() {
+                if constexpr(Enabled) {
+                    if (_changed.exchange(false, std::memory_order_acquire)) {
+                        std::lock_guard<std::mutex> lock(_mutex);
+                        _tracer = _new_tracer;
+                    }
+                }
+            }
+
+            bool is_active() const noexcept {
+                return Enabled && _tracer;
+            }
+
+            void begin(collector_phase phase) noexcept {
+                if constexpr(Enabled) {
+                    if (_tracer) {
+                        _tracer->begin(phase);
+                    }
+                }
+            }
+
+            void end(collector_phase phase, int64_t objects = 0, int64_t pages = 0) noexcept {
+                if constexpr(Enabled) {
+                    if (_tracer) {
+                        _tracer->end(phase, objects, pages);
+                    }
+                }
+            }
+
+        private:
+            std::shared_ptr<collector_tracer> _tracer;
+            std::shared_ptr<collector_tracer> _new_tracer;
+            std::mutex _mutex;
+            std::atomic<bool> _changed = {false};
+        };
+    }
+}
@@ -6,6 +6,9 @@
 #pragma once
 
 #include "page.h"
+#include "simd.h"
+
+#include <algorithm>
 
 namespace sgcl {
     namespace Priv {
@@ -27,16 +30,15 @@ namespace sgcl {
                 auto object_size = page->metadata->object_size;
                 auto states = page->states();
                 auto count = page->metadata->object_count;
-                [[maybe_unused]] bool unused = false;
-                for(int i = count - 1; i >= 0; --i) {
-                    if (states[i].load(std::memory_order_relaxed) == State::Unused) {
-                        _indexes[--_position] = (void*)(data + i * object_size);
-                        states[i].store(State::Reserved, std::memory_order_relaxed);
-                        unused = true;
-                    }
-                }
+                auto position = _position;
+                State_scan::for_each(states, count, State::Unused, State::Unused, [&](unsigned i) {
+                    _indexes[--_position] = (void*)(data + i * object_size);
+                    states[i].store(State::Reserved, std::memory_order_relaxed);
+                });
                 std::atomic_thread_fence(std::memory_order_release);
-                assert(unused);
+                assert(_position < position);
+                // the lowest addresses are allocated first
+                std::reverse(_indexes + _position, _indexes + position);
             }
             unsigned pointer_count() const noexcept {
                 return _size - _position;
@@ -0,0 +1,303 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "../configuration.h"
+#include "page.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+#if SGCL_PROFILER_STACK_DEPTH && __has_include(<execinfo.h>)
+#include <execinfo.h>
+#define SGCL_PROFILER_BACKTRACE 1
+#endif
+#if SGCL_PROFILER_STACK_DEPTH && __has_include(<dlfcn.h>)
+#include <dlfcn.h>
+#define SGCL_PROFILER_DLADDR 1
+#endif
+#if __has_include(<cxxabi.h>)
+#include <cxxabi.h>
+#define SGCL_PROFILER_DEMANGLE 1
+#endif
+
+namespace sgcl {
+    namespace Priv {
+        // samples an allocation every rate bytes, the samples are followed until they are swept
+        struct Profiler {
+            static constexpr unsigned SurvivalCycles[] = {1, 2, SGCL_PROFILER_SURVIVAL_CYCLES};
+            static constexpr unsigned SurvivalCount = std::size(SurvivalCycles);
+
+            // called after each allocation, countdown is the thread's byte counter
+            static void allocated(int64_t& countdown, const void* p, const std::type_info& type, size_t size) {
+                countdown -= size;
+                if (countdown < 0) {
+                    countdown = _rate.load(std::memory_order_relaxed);
+                    if (countdown) {
+                        _sample(p, type, size);
+                    } else {
+                        countdown = INT64_MAX;
+                    }
+                }
+            }
+
+            static void set_rate(size_t rate) noexcept {
+                _rate.store((int64_t)std::min<size_t>(rate, INT64_MAX), std::memory_order_relaxed);
+            }
+
+            static size_t rate() noexcept {
+                return _rate.load(std::memory_order_relaxed);
+            }
+
+            // called by the collector for swept objects on pages with samples
+            static void released(Page* page, const void* p) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                auto sample = _samples.find(p);
+                if (sample != _samples.end()) {
+                    sample->second.site->live--;
+                    _samples.erase(sample);
+                    page->sampled.fetch_sub(1, std::memory_order_relaxed);
+                }
+            }
+
+            // called by the collector once per cycle, after the sweep
+            static void update_ages() {
+                std::lock_guard<std::mutex> lock(_mutex);
+                for (auto& [p, sample] : _samples) {
+                    ++sample.age;
+                    for (unsigned i = 0; i < SurvivalCount; ++i) {
+                        if (sample.age == SurvivalCycles[i]) {
+                            sample.site->survived[i]++;
+                        }
+                    }
+                }
+            }
+
+            // writes an uncompressed profile.proto message, see https://github.com/google/pprof
+            static void write(std::ostream& out) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                Profile_writer writer;
+                auto rate = _rate.load(std::memory_order_relaxed);
+                writer.value_type(1, "alloc_objects", "count");
+                writer.value_type(1, "alloc_space", "bytes");
+                writer.value_type(1, "inuse_objects", "count");
+                writer.value_type(1, "inuse_space", "bytes");
+                for (auto cycles : SurvivalCycles) {
+                    writer.value_type(1, "survived_" + std::to_string(cycles), "count");
+                }
+                for (auto& [key, site] : _sites) {
+                    // a sample stands for rate bytes of objects of the same size
+                    auto weight = site.size < (size_t)rate ? (double)rate / site.size : 1.0;
+                    auto objects = [&](uint64_t n) {
+                        return (int64_t)(n * weight + 0.5);
+                    };
+                    std::vector<uint64_t> locations;
+                    locations.emplace_back(writer.location(0, "new " + _type_name(*site.type)));
+                    auto stack = _stacks.find(site.stack);
+                    if (stack != _stacks.end()) {
+                        for (auto address : stack->second) {
+                            locations.emplace_back(writer.location((uintptr_t)address, _symbol_name(address)));
+                        }
+                    }
+                    std::vector<int64_t> values = {
+                        objects(site.allocated), objects(site.allocated) * (int64_t)site.size,
+                        objects(site.live), objects(site.live) * (int64_t)site.size
+                    };
+                    for (auto survived : site.survived) {
+                        values.emplace_back(objects(survived));
+                    }
+                    writer.sample(locations, values, "bytes", site.size);
+                }
+                writer.value_type(11, "space", "bytes");
+                writer.field(12, (uint64_t)rate);
+                writer.field(14, writer.string("inuse_space"));
+                out << writer.finish();
+            }
+
+        private:
+            using Site_key = std::tuple<const std::type_info*, size_t, uint64_t>;
+
+            struct Site {
+                const std::type_info* type;
+                size_t size;
+                uint64_t stack;
+                uint64_t allocated = {0};
+                uint64_t live = {0};
+                uint64_t survived[SurvivalCount] = {};
+            };
+
+            struct Sample {
+                Site* site;
+                unsigned age;
+            };
+
+            struct Proto {
+                void varint(uint64_t v) {
+                    while (v >= 0x80) {
+                        data += (char)(v | 0x80);
+                        v >>= 7;
+                    }
+                    data += (char)v;
+                }
+
+                void field(unsigned id, uint64_t v) {
+                    varint(id << 3);
+                    varint(v);
+                }
+
+                void field(unsigned id, const std::string& s) {
+                    varint(id << 3 | 2);
+                    varint(s.size());
+                    data += s;
+                }
+
+                template<class T>
+                void packed(unsigned id, const std::vector<T>& values) {
+                    Proto p;
+                    for (auto v : values) {
+                        p.varint((uint64_t)v);
+                    }
+                    field(id, p.data);
+                }
+
+                std::string data;
+            };
+
+            struct Profile_writer : Proto {
+                Profile_writer() {
+                    string("");
+                }
+
+                int64_t string(const std::string& s) {
+                    auto [it, inserted] = _strings.try_emplace(s, _strings.size());
+                    if (inserted) {
+                        _string_table.field(6, s);
+                    }
+                    return it->second;
+                }
+
+                void value_type(unsigned id, const std::string& type, const std::string& unit) {
+                    Proto p;
+                    p.field(1, string(type));
+                    p.field(2, string(unit));
+                    field(id, p.data);
+                }
+
+                // one function and one location per name and address
+                uint64_t location(uint64_t address, const std::string& name) {
+                    auto [it, inserted] = _locations.try_emplace({address, name}, _locations.size() + 1);
+                    if (inserted) {
+                        auto id = it->second;
+                        Proto function;
+                        function.field(1, id);
+                        function.field(2, string(name));
+                        field(5, function.data);
+                        Proto line;
+                        line.field(1, id);
+                        Proto location;
+                        location.field(1, id);
+                        location.field(3, address);
+                        location.field(4, line.data);
+                        field(4, location.data);
+                    }
+                    return it->second;
+                }
+
+                void sample(const std::vector<uint64_t>& locations, const std::vector<int64_t>& values, const std::string& label, int64_t num) {
+                    Proto l;
+                    l.field(1, string(label));
+                    l.field(3, num);
+                    Proto s;
+                    s.packed(1, locations);
+                    s.packed(2, values);
+                    s.field(3, l.data);
+                    field(2, s.data);
+                }
+
+                std::string finish() {
+                    return data + _string_table.data;
+                }
+
+            private:
+                std::map<std::string, int64_t> _strings;
+                std::map<std::pair<uint64_t, std::string>, uint64_t> _locations;
+                Proto _string_table;
+            };
+
+            // not inlined, so that it is the only skipped frame
+#if defined(__GNUC__)
+            __attribute__((noinline))
+#endif
+            static void _sample(const void* p, const std::type_info& type, size_t size) {
+                uint64_t stack = 0;
+#if SGCL_PROFILER_BACKTRACE
+                void* frames[SGCL_PROFILER_STACK_DEPTH + 1];
+                auto depth = backtrace(frames, SGCL_PROFILER_STACK_DEPTH + 1);
+                for (int i = 1; i < depth; ++i) {
+                    stack = (stack ^ (uintptr_t)frames[i]) * 0x100000001b3ull;
+                }
+#endif
+                std::lock_guard<std::mutex> lock(_mutex);
+#if SGCL_PROFILER_BACKTRACE
+                if (stack && !_stacks.count(stack)) {
+                    _stacks[stack].assign(frames + 1, frames + depth);
+                }
+#endif
+                auto [it, inserted] = _sites.try_emplace({&type, size, stack}, Site{&type, size, stack});
+                auto& site = it->second;
+                site.allocated++;
+                site.live++;
+                _samples[p] = {&site, 0};
+                Page::page_of(p)->sampled.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            static std::string _demangle(const char* name) {
+#if SGCL_PROFILER_DEMANGLE
+                int status = 0;
+                auto demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+                if (demangled) {
+                    std::string result = demangled;
+                    std::free(demangled);
+                    return result;
+                }
+#endif
+                return name;
+            }
+
+            static std::string _type_name(const std::type_info& type) {
+                return _demangle(type.name());
+            }
+
+            static std::string _symbol_name(const void* address) {
+#if SGCL_PROFILER_DLADDR
+                Dl_info info;
+                if (dladdr(address, &info) && info.dli_sname) {
+                    return _demangle(info.dli_sname);
+                }
+#endif
+                char name[2 + sizeof(uintptr_t) * 2 + 1];
+                std::snprintf(name, sizeof(name), "0x%zx", (size_t)(uintptr_t)address);
+                return name;
+            }
+
+            inline static std::atomic<int64_t> _rate = {SGCL_PROFILER_RATE};
+            inline static std::mutex _mutex;
+            inline static std::map<Site_key, Site> _sites;
+            inline static std::unordered_map<const void*, Sample> _samples;
+            inline static std::unordered_map<uint64_t, std::vector<void*>> _stacks;
+        };
+    }
+}
@@ -0,0 +1,97 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "mark_stack.h"
+#include "types.h"
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace sgcl {
+    namespace Priv {
+        // the slots of a root_block, registered as a whole
+        struct Root_block {
+            Pointer* const pointers;
+            const unsigned count;
+            unsigned shard = {0};
+            size_t index = {0};
+        };
+
+        struct alignas(64) Root_block_shard {
+            std::atomic_flag lock = ATOMIC_FLAG_INIT;
+            std::vector<Root_block*> blocks;
+        };
+
+        // the blocks are listed in shards with their own locks, so threads creating and destroying
+        // blocks, e.g. the frames of coroutines, do not contend on one list; a block can be destroyed
+        // by any thread; the lists are arrays, so the collector prefetches the blocks it scans
+        struct Root_blocks {
+            static constexpr unsigned ShardCount = 256;
+
+            static void add(Root_block* block) {
+                auto hash = (uint64_t)(uintptr_t)block * 0x9E3779B97F4A7C15ull;
+                block->shard = unsigned(hash >> 32) % ShardCount;
+                auto& shard = _shards[block->shard];
+                _lock(shard);
+                block->index = shard.blocks.size();
+                try {
+                    shard.blocks.emplace_back(block);
+                } catch (...) {
+                    _unlock(shard);
+                    throw;
+                }
+                _unlock(shard);
+            }
+
+            static void remove(Root_block* block) noexcept {
+                auto& shard = _shards[block->shard];
+                _lock(shard);
+                auto last = shard.blocks.back();
+                shard.blocks[block->index] = last;
+                last->index = block->index;
+                shard.blocks.pop_back();
+                _unlock(shard);
+            }
+
+            // called by the collector only
+            template<class F>
+            static void for_each(F&& f) {
+                for (auto& shard : _shards) {
+                    _lock(shard);
+                    auto& blocks = shard.blocks;
+                    for (size_t i = 0; i < blocks.size(); ++i) {
+                        if (i + PrefetchDistance < blocks.size()) {
+                            Prefetch(blocks[i + PrefetchDistance]->pointers);
+                        }
+                        auto block = blocks[i];
+                        for (unsigned j = 0; j < block->count; ++j) {
+                            f(block->pointers[j]);
+                        }
+                    }
+                    _unlock(shard);
+                }
+            }
+
+        private:
+            static constexpr size_t PrefetchDistance = 8;
+
+            // the holder may be preempted, e.g. the collector scanning a shard
+            static void _lock(Root_block_shard& shard) noexcept {
+                while (shard.lock.test_and_set(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+            }
+
+            static void _unlock(Root_block_shard& shard) noexcept {
+                shard.lock.clear(std::memory_order_release);
+            }
+
+            inline static Root_block_shard _shards[ShardCount];
+        };
+    }
+}
@@ -0,0 +1,155 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "../configuration.h"
+#include "types.h"
+
+#include <cassert>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if SGCL_SIMD && defined(__AVX2__)
+#include <immintrin.h>
+#define SGCL_SIMD_AVX2
+#elif SGCL_SIMD && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define SGCL_SIMD_SSE2
+#elif SGCL_SIMD && (defined(__ARM_NEON) || defined(_M_ARM64))
+#include <arm_neon.h>
+#define SGCL_SIMD_NEON
+#endif
+
+namespace sgcl {
+    namespace Priv {
+        inline unsigned Countr_zero(uint64_t v) noexcept {
+            assert(v != 0);
+#if defined(_MSC_VER)
+            unsigned long index;
+            _BitScanForward64(&index, v);
+            return (unsigned)index;
+#else
+            return (unsigned)__builtin_ctzll(v);
+#endif
+        }
+
+        inline unsigned Popcount(uint64_t v) noexcept {
+#if defined(_MSC_VER)
+            return (unsigned)__popcnt64(v);
+#else
+            return (unsigned)__builtin_popcountll(v);
+#endif
+        }
+
+        template<class F>
+        inline void For_each_bit(uint64_t bits, F&& f) {
+            while (bits) {
+                f(Countr_zero(bits));
+                bits &= bits - 1;
+            }
+        }
+
+        // kernels scanning object state arrays, the states are read with plain loads
+        // like the relaxed loads of the scalar code
+        struct State_scan {
+#if defined(SGCL_SIMD_AVX2)
+            static constexpr unsigned LaneCount = 32;
+            static constexpr unsigned LaneBits = 1;
+#elif defined(SGCL_SIMD_SSE2)
+            static constexpr unsigned LaneCount = 16;
+            static constexpr unsigned LaneBits = 1;
+#elif defined(SGCL_SIMD_NEON)
+            static constexpr unsigned LaneCount = 16;
+            static constexpr unsigned LaneBits = 4;
+#else
+            static constexpr unsigned LaneCount = 8;
+            static constexpr unsigned LaneBits = 1;
+#endif
+#if defined(SGCL_SIMD_NEON)
+            static constexpr uint64_t FullMask = 0x8888888888888888ull;
+#else
+            static constexpr uint64_t FullMask = (uint64_t(1) << LaneCount) - 1;
+#endif
+
+            // calls f(index) for every state in the range [min, max]
+            template<class F>
+            static void for_each(const std::atomic<State>* states, unsigned count, State min, State max, F&& f) {
+                unsigned i = 0;
+                for (; i + LaneCount <= count; i += LaneCount) {
+                    For_each_bit(_match(states + i, min, max), [&](unsigned b) {
+                        f(i + b / LaneBits);
+                    });
+                }
+                for (; i < count; ++i) {
+                    auto state = states[i].load(std::memory_order_relaxed);
+                    if (state >= min && state <= max) {
+                        f(i);
+                    }
+                }
+            }
+
+            static bool any_of(const std::atomic<State>* states, unsigned count, State state) noexcept {
+                unsigned i = 0;
+                for (; i + LaneCount <= count; i += LaneCount) {
+                    if (_match(states + i, state, state)) {
+                        return true;
+                    }
+                }
+                for (; i < count; ++i) {
+                    if (states[i].load(std::memory_order_relaxed) == state) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            static bool all_of(const std::atomic<State>* states, unsigned count, State state) noexcept {
+                unsigned i = 0;
+                for (; i + LaneCount <= count; i += LaneCount) {
+                    if (_match(states + i, state, state) != FullMask) {
+                        return false;
+                    }
+                }
+                for (; i < count; ++i) {
+                    if (states[i].load(std::memory_order_relaxed) != state) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+        private:
+            static uint64_t _match(const std::atomic<State>* states, State min, State max) noexcept {
+                static_assert(sizeof(std::atomic<State>) == sizeof(State));
+#if defined(SGCL_SIMD_AVX2)
+                auto v = _mm256_loadu_si256((const __m256i*)states);
+                auto in_min = _mm256_cmpeq_epi8(_mm256_max_epu8(v, _mm256_set1_epi8((char)min)), v);
+                auto in_max = _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8((char)max)), v);
+                return (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(in_min, in_max));
+#elif defined(SGCL_SIMD_SSE2)
+                auto v = _mm_loadu_si128((const __m128i*)states);
+                auto in_min = _mm_cmpeq_epi8(_mm_max_epu8(v, _mm_set1_epi8((char)min)), v);
+                auto in_max = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8((char)max)), v);
+                return (uint32_t)_mm_movemask_epi8(_mm_and_si128(in_min, in_max));
+#elif defined(SGCL_SIMD_NEON)
+                auto v = vld1q_u8((const uint8_t*)states);
+                auto match = vandq_u8(vcgeq_u8(v, vdupq_n_u8(min)), vcleq_u8(v, vdupq_n_u8(max)));
+                auto mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(match), 4)), 0);
+                return mask & 0x8888888888888888ull;
+#else
+                uint64_t mask = 0;
+                for (unsigned i = 0; i < LaneCount; ++i) {
+                    auto state = states[i].load(std::memory_order_relaxed);
+                    mask |= uint64_t(state >= min && state <= max) << i;
+                }
+                return mask;
+#endif
+            }
+        };
+    }
+}
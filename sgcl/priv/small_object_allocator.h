@@ -15,23 +15,20 @@ namespace sgcl {
             using Type = typename Info::type;
             using Pointer_pool = Priv::Pointer_pool<Info::ObjectCount, sizeof(std::conditional_t<std::is_same_v<Type, void>, char, Type>)>;
 
-            constexpr Small_object_allocator(Block_allocator& a) noexcept
-                : Small_object_allocator_base(a, _pointer_pool, _pages_buffer, _lock) {
+            constexpr Small_object_allocator(Block_allocator& a, Page** arena_pages = nullptr, Pool_buffer* pool_buffer = nullptr) noexcept
+                : Small_object_allocator_base(a, _pointer_pool, _pages_buffer, arena_pages, pool_buffer) {
             }
 
             static void free(Page* pages) {
-                _free(pages, _pages_buffer, _lock);
+                _free(pages, _pages_buffer);
             }
 
         private:
-            inline static Page* _pages_buffer = {nullptr};
-            inline static std::atomic_flag _lock = ATOMIC_FLAG_INIT;
+            inline static Page_stack _pages_buffer;
             Pointer_pool _pointer_pool;
 
             Page* _create_page_parameters(Data_page* data) override {
-                auto mem = ::operator new(Info::HeaderSize);
-                auto page = new(mem) Page(data->block, (Type*)data->data);
-                return page;
+                return Page::create(data->block, (Type*)data->data);
             }
         };
     }
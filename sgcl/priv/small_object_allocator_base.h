@@ -6,43 +6,66 @@
 #pragma once
 
 #include "block_allocator.h"
+#include "page_pool.h"
 #include "object_allocator.h"
+#include "page_stack.h"
+#include "simd.h"
+
+#include <cstring>
+
+#if SGCL_LATENCY_HISTOGRAMS
+#include "latency.h"
+#endif
 
 namespace sgcl {
     namespace Priv {
         struct Small_object_allocator_base : Object_allocator {
-            Small_object_allocator_base(Block_allocator& ba, Pointer_pool_base& pa, Page*& pb, std::atomic_flag& lock) noexcept
+            // the number of pages taken from the shared buffer at once
+            static constexpr unsigned RefillPageCount = 4;
+
+            // the allocator of an arena scope takes new pages only and links them to the arena pages,
+            // the allocator of a page pool takes the pages of the pool buffer and adds new pages to the pool
+            Small_object_allocator_base(Block_allocator& ba, Pointer_pool_base& pa, Page_stack& pb, Page** ap, Pool_buffer* hb = nullptr) noexcept
                 : _block_allocator(ba)
                 , _pointer_pool(pa)
-                , _pages_buffer(pb)
-                , _lock(lock) {
+                , _pages_buffer(hb ? hb->pages : pb)
+                , _arena_pages(ap)
+                , _pool_buffer(hb) {
             }
 
             ~Small_object_allocator_base() noexcept override {
+                // the collector looks for unused places on dirty pages, the page is marked before
+                // the places are released, so it cannot be freed in the meantime
+                if (!_pointer_pool.is_empty()) {
+                    _current_page->set_dirty();
+                }
                 while (!_pointer_pool.is_empty()) {
                     auto ptr = _pointer_pool.alloc();
                     auto index = _current_page->index_of(ptr);
                     _current_page->states()[index].store(State::Unused, std::memory_order_relaxed);
                 }
                 std::atomic_thread_fence(std::memory_order_release);
+                if (_reserved_pages) {
+                    _pages_buffer.push(_reserved_pages, _last_of(_reserved_pages));
+                }
             }
 
             void* alloc(size_t = 0) {
                 if  (_pointer_pool.is_empty()) {
-                    while (_lock.test_and_set(std::memory_order_acquire));
-                    auto page = _pages_buffer;
-                    if (page) {
-                        _pages_buffer = page->next_empty;
+#if SGCL_LATENCY_HISTOGRAMS
+                    Latency_scope latency(latency_event::pool_refill);
+#endif
+                    if (!_reserved_pages && !_arena_pages) {
+                        _reserved_pages = _pages_buffer.pop(RefillPageCount);
                     }
-                    _lock.clear(std::memory_order_release);
+                    auto page = _reserved_pages;
                     if (page) {
+                        _reserved_pages = page->next_empty;
                         _pointer_pool.fill(page);
                         page->on_empty_list.store(false, std::memory_order_release);
                     } else {
                         page = _alloc_page();
                         _pointer_pool.fill((void*)(page->data));
-                        page->next = pages.load(std::memory_order_acquire);
-                        while(!pages.compare_exchange_weak(page->next, page, std::memory_order_release, std::memory_order_relaxed));
                     }
                     _current_page = page;
                 }
@@ -53,35 +76,52 @@ namespace sgcl {
         private:
             Block_allocator& _block_allocator;
             Pointer_pool_base& _pointer_pool;
-            Page*& _pages_buffer;
-            std::atomic_flag& _lock;
+            Page_stack& _pages_buffer;
+            Page** const _arena_pages;
+            Pool_buffer* const _pool_buffer;
             Page* _current_page = {nullptr};
+            Page* _reserved_pages = {nullptr};
 
             virtual Page* _create_page_parameters(Data_page*) = 0;
 
             Page* _alloc_page() {
-                auto data = _block_allocator.alloc();
+#if SGCL_LATENCY_HISTOGRAMS
+                Latency_scope latency(latency_event::new_page);
+#endif
+                bool zeroed;
+                auto data = _block_allocator.alloc(zeroed);
+                if (SGCL_ZEROED_SLOTS && !zeroed) {
+                    std::memset(data->data, 0, sizeof(data->data));
+                }
                 auto page = _create_page_parameters(data);
                 data->page = page;
+                page->zeroed = SGCL_ZEROED_SLOTS;
+                if (_arena_pages) {
+                    page->arena = Page::Arena::Active;
+                    page->next_arena = *_arena_pages;
+                    *_arena_pages = page;
+                } else if (_pool_buffer) {
+                    page->arena = Page::Arena::Pool;
+                    page->pool_buffer = _pool_buffer;
+                    _pool_buffer->pool.add_page(page);
+                }
                 return page;
             }
 
+        public:
+            // the pages with unused places go to the buffer, the empty ones to the block allocator
+            static void free(Page* pages, Page_stack& pages_buffer) noexcept {
+                _free(pages, pages_buffer);
+            }
+
         protected:
-            static void _remove_empty(Page*& pages, Page*& empty_pages) noexcept {
+            // returns the last page left
+            static Page* _remove_empty(Page*& pages, Page*& empty_pages) noexcept {
                 auto page = pages;
                 Page* prev = nullptr;
                 while(page) {
                     auto next = page->next_empty;
-                    auto states = page->states();
-                    auto object_count = page->metadata->object_count;
-                    auto unused_count = 0u;
-                    for (unsigned i = 0; i < object_count; ++i) {
-                        auto state = states[i].load(std::memory_order_relaxed);
-                        if (state == State::Unused) {
-                            ++unused_count;
-                        }
-                    }
-                    if (unused_count == object_count) {
+                    if (State_scan::all_of(page->states(), page->metadata->object_count, State::Unused)) {
                         page->next_empty = empty_pages;
                         empty_pages = page;
                         if (!prev) {
@@ -95,6 +135,7 @@ namespace sgcl {
                     page = next;
                 }
                 std::atomic_thread_fence(std::memory_order_release);
+                return prev;
             }
 
             static void _free(Page* pages) noexcept {
@@ -111,23 +152,25 @@ namespace sgcl {
                 Block_allocator::free(empty);
             }
 
-            static void _free(Page* pages, Page*& pages_buffer, std::atomic_flag& lock) noexcept {
+            static Page* _last_of(Page* pages) noexcept {
+                while(pages->next_empty) {
+                    pages = pages->next_empty;
+                }
+                return pages;
+            }
+
+            // the buffered pages are scanned for empty ones, the tails are known from the scans,
+            // so the pages left go back with one push each
+            static void _free(Page* pages, Page_stack& pages_buffer) noexcept {
                 Page* empty_pages = nullptr;
-                for (int i = 0; i < 2 ; ++i) {
-                    _remove_empty(pages, empty_pages);
-                    while (lock.test_and_set(std::memory_order_acquire));
-                    std::swap(pages, pages_buffer);
-                    lock.clear(std::memory_order_release);
+                auto last = _remove_empty(pages, empty_pages);
+                auto buffered = pages_buffer.take();
+                auto buffered_last = _remove_empty(buffered, empty_pages);
+                if (buffered) {
+                    pages_buffer.push(buffered, buffered_last);
                 }
                 if (pages) {
-                    auto last = pages;
-                    while(last->next_empty) {
-                        last = last->next_empty;
-                    }
-                    while (lock.test_and_set(std::memory_order_acquire));
-                    last->next_empty = pages_buffer;
-                    pages_buffer = pages;
-                    lock.clear(std::memory_order_release);
+                    pages_buffer.push(pages, last);
                 }
                 if (empty_pages) {
                     _free(empty_pages);
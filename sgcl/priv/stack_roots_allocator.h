@@ -7,15 +7,23 @@
 
 #include "../configuration.h"
 #include "data_page.h"
+#include "simd.h"
 
 #include <array>
 
 namespace sgcl {
     namespace Priv {
+        // a slot is mapped from the address of the root on the stack, the bitmaps of used pages and slots
+        // are written by the owner thread only, so the collector scans the existing roots only
         struct Stack_roots_allocator {
             static constexpr unsigned PageCount = MaxStackSize / PageSize;
             static constexpr size_t PointerCount = PageSize / sizeof(Pointer);
-            using Page = std::array<Pointer, PointerCount>;
+            static constexpr unsigned WordBits = 64;
+
+            struct Page {
+                std::array<Pointer, PointerCount> pointers = {};
+                std::atomic<uint64_t> used[PointerCount / WordBits] = {};
+            };
 
             ~Stack_roots_allocator() noexcept {
                 for (auto& page : pages) {
@@ -24,17 +32,63 @@ namespace sgcl {
             }
 
             Tracked_ptr* alloc(void* p) {
-                auto index = ((uintptr_t)p / PageSize) % PageCount;
+                auto index = _index_of(p);
                 auto page = pages[index].load(std::memory_order_relaxed);
                 if (!page) {
-                    page = new Page{};
-                    pages[index].store(page, std::memory_order_release);
+                    page = _alloc_page(index);
+                }
+                auto offset = _offset_of(p);
+                _set(page->used[offset / WordBits], offset % WordBits);
+                return (Tracked_ptr*)&page->pointers[offset];
+            }
+
+            // the root can be destroyed by another thread, then the slot stays in the bitmap
+            void free(void* p, Tracked_ptr* ref) noexcept {
+                auto page = pages[_index_of(p)].load(std::memory_order_relaxed);
+                auto offset = _offset_of(p);
+                if (page && (Tracked_ptr*)&page->pointers[offset] == ref) {
+                    auto& word = page->used[offset / WordBits];
+                    word.store(word.load(std::memory_order_relaxed) & ~(uint64_t(1) << (offset % WordBits)), std::memory_order_release);
+                }
+            }
+
+            template<class F>
+            void for_each(F&& f) const {
+                for (unsigned i = 0; i < std::size(_used_pages); ++i) {
+                    For_each_bit(_used_pages[i].load(std::memory_order_acquire), [&](unsigned j) {
+                        auto page = pages[i * WordBits + j].load(std::memory_order_acquire);
+                        for (unsigned k = 0; k < std::size(page->used); ++k) {
+                            For_each_bit(page->used[k].load(std::memory_order_acquire), [&](unsigned l) {
+                                f(page->pointers[k * WordBits + l]);
+                            });
+                        }
+                    });
                 }
-                auto offset = ((uintptr_t)p % PageSize) / sizeof(Pointer);
-                return (Tracked_ptr*)&(*page)[offset];
             }
 
             std::atomic<Page*> pages[PageCount] = {};
+
+        private:
+            static unsigned _index_of(void* p) noexcept {
+                return ((uintptr_t)p / PageSize) % PageCount;
+            }
+
+            static unsigned _offset_of(void* p) noexcept {
+                return ((uintptr_t)p % PageSize) / sizeof(Pointer);
+            }
+
+            Page* _alloc_page(unsigned index) {
+                auto page = new Page;
+                pages[index].store(page, std::memory_order_release);
+                _set(_used_pages[index / WordBits], index % WordBits);
+                return page;
+            }
+
+            static void _set(std::atomic<uint64_t>& word, unsigned bit) noexcept {
+                word.store(word.load(std::memory_order_relaxed) | (uint64_t(1) << bit), std::memory_order_release);
+            }
+
+            std::atomic<uint64_t> _used_pages[(PageCount + WordBits - 1) / WordBits] = {};
         };
     }
 }
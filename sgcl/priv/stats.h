@@ -0,0 +1,89 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "../collector_stats.h"
+
+#include <array>
+#include <cassert>
+#include <atomic>
+#include <cstring>
+
+namespace sgcl {
+    namespace Priv {
+        // a sequence lock, the GC thread is the only writer
+        struct Stats {
+            static_assert(sizeof(collector_stats) % sizeof(uint64_t) == 0);
+            static_assert(sizeof(int64_t) == sizeof(uint64_t) && sizeof(double) == sizeof(uint64_t));
+
+            void store(const collector_stats& stats) noexcept {
+                std::array<uint64_t, WordCount> words;
+                size_t index = 0;
+                _for_each_field(stats, [&](const auto& field) {
+                    std::memcpy(&words[index++], &field, sizeof(uint64_t));
+                });
+                assert(index == WordCount);
+                auto sequence = _sequence.load(std::memory_order_relaxed);
+                _sequence.store(sequence + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                for (size_t i = 0; i < WordCount; ++i) {
+                    _words[i].store(words[i], std::memory_order_relaxed);
+                }
+                _sequence.store(sequence + 2, std::memory_order_release);
+            }
+
+            collector_stats load() const noexcept {
+                std::array<uint64_t, WordCount> words;
+                unsigned sequence;
+                do {
+                    sequence = _sequence.load(std::memory_order_acquire);
+                    for (size_t i = 0; i < WordCount; ++i) {
+                        words[i] = _words[i].load(std::memory_order_relaxed);
+                    }
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                } while((sequence & 1) || sequence != _sequence.load(std::memory_order_relaxed));
+                collector_stats stats;
+                size_t index = 0;
+                _for_each_field(stats, [&](auto& field) {
+                    std::memcpy(&field, &words[index++], sizeof(uint64_t));
+                });
+                return stats;
+            }
+
+        private:
+            static constexpr size_t WordCount = sizeof(collector_stats) / sizeof(uint64_t);
+
+            // collector_stats is not trivial, so the fields are copied one by one
+            template<class S, class F>
+            static void _for_each_field(S& s, F&& f) noexcept {
+                f(s.cycles);
+                f(s.allocated_objects);
+                f(s.allocated_bytes);
+                f(s.removed_objects);
+                f(s.removed_bytes);
+                f(s.total_time);
+                f(s.last_allocated_objects);
+                f(s.last_allocated_bytes);
+                f(s.last_removed_objects);
+                f(s.last_removed_bytes);
+                f(s.last_time);
+                f(s.last_states_time);
+                f(s.last_register_time);
+                f(s.last_roots_time);
+                f(s.last_mark_time);
+                f(s.last_sweep_time);
+                f(s.last_release_time);
+                f(s.live_objects);
+                f(s.live_bytes);
+                f(s.heap_bytes);
+                f(s.threads);
+            }
+
+            std::atomic<unsigned> _sequence = {0};
+            std::array<std::atomic<uint64_t>, WordCount> _words = {};
+        };
+    }
+}
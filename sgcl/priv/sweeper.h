@@ -0,0 +1,150 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "../configuration.h"
+#include "page.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sgcl {
+    namespace Priv {
+        struct Sweeper {
+            using Batch = std::vector<void*>;
+            using Executor = std::function<void(std::function<void()>)>;
+            static constexpr size_t BatchSize = 1024;
+
+            // which destructors are left to the sweeper in a sweep
+            enum class Mode {None, Opted, All};
+
+            Sweeper(void (*destroy)(Page*, void*) noexcept) noexcept
+                : _destroy(destroy) {
+            }
+
+            ~Sweeper() {
+                stop();
+            }
+
+            void set_executor(Executor executor, bool all_types) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _executor = std::move(executor);
+                _all_types = all_types;
+            }
+
+            Mode mode() {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (_executor) {
+                    return _all_types ? Mode::All : Mode::Opted;
+                }
+                return SGCL_SWEEPING_THREADS ? Mode::All : Mode::None;
+            }
+
+            void push(Batch&& batch) {
+                Executor executor;
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    ++_pending;
+                    executor = _executor;
+                }
+                // the executor is called without the lock, it may run the task at once
+                if (executor) {
+                    executor([this, batch = std::move(batch)]{
+                        _run(batch);
+                    });
+                    return;
+                }
+                // without an executor the batches go to the sweeping threads, they are run at once
+                // if there are none, e.g. the executor was reset during the sweep, or after stop()
+                if constexpr(SGCL_SWEEPING_THREADS > 0) {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    if (!_stop) {
+                        if (_threads.empty()) {
+                            for (auto i = SGCL_SWEEPING_THREADS; i > 0; --i) {
+                                _threads.emplace_back([this]{_loop();});
+                            }
+                        }
+                        _batches.emplace_back(std::move(batch));
+                        lock.unlock();
+                        _cv.notify_one();
+                        return;
+                    }
+                }
+                _run(batch);
+            }
+
+            void wait() noexcept {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _done_cv.wait(lock, [this]{
+                    return !_pending;
+                });
+            }
+
+            // the threads run the batches left and are joined, the mutex and the condition
+            // variables are not destroyed while they wake up
+            void stop() noexcept {
+                std::vector<std::thread> threads;
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _stop = true;
+                    threads.swap(_threads);
+                }
+                _cv.notify_all();
+                for (auto& thread: threads) {
+                    thread.join();
+                }
+            }
+
+        private:
+            void _loop() noexcept {
+                for (;;) {
+                    Batch batch;
+                    {
+                        std::unique_lock<std::mutex> lock(_mutex);
+                        _cv.wait(lock, [this]{
+                            return !_batches.empty() || _stop;
+                        });
+                        if (_batches.empty()) {
+                            return;
+                        }
+                        batch = std::move(_batches.front());
+                        _batches.pop_front();
+                    }
+                    _run(batch);
+                }
+            }
+
+            // the slots are released after the destructors
+            void _run(const Batch& batch) noexcept {
+                for (auto ptr: batch) {
+                    auto page = Page::page_of(ptr);
+                    _destroy(page, ptr);
+                    page->clear(page->index_of(ptr));
+                    page->states()[page->index_of(ptr)].store(State::Unused, std::memory_order_release);
+                }
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (!--_pending) {
+                    _done_cv.notify_all();
+                }
+            }
+
+            void (*const _destroy)(Page*, void*) noexcept;
+            std::mutex _mutex;
+            std::condition_variable _cv;
+            std::condition_variable _done_cv;
+            std::deque<Batch> _batches;
+            Executor _executor;
+            size_t _pending = {0};
+            std::vector<std::thread> _threads;
+            bool _all_types = {false};
+            bool _stop = {false};
+        };
+    }
+}
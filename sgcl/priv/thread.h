@@ -11,7 +11,14 @@
 #include "small_object_allocator.h"
 #include "stack_roots_allocator.h"
 
+#include <condition_variable>
+#include <mutex>
 #include <thread>
+#include <vector>
+
+#if SGCL_PROFILER
+#include "profiler.h"
+#endif
 
 #if SGCL_LOG_PRINT_LEVEL
 #include <iostream>
@@ -19,6 +26,7 @@
 
 namespace sgcl {
     namespace Priv {
+        void Collector_init();
         void Terminate_collector();
         struct Thread {
             struct Data {
@@ -26,13 +34,48 @@ namespace sgcl {
                 : block_allocator(b)
                 , stack_roots_allocator(s) {
                 }
+
+                void update_allocated(size_t s, size_t n = 1) {
+                    auto count = alloc_count.load(std::memory_order_relaxed) + (int64_t)n;
+                    alloc_count.store(count, std::memory_order_relaxed);
+                    auto size = alloc_size.load(std::memory_order_relaxed) + (int64_t)s;
+                    alloc_size.store(size, std::memory_order_relaxed);
+                    if (count >= wakeup_count.load(std::memory_order_relaxed) || size >= wakeup_size.load(std::memory_order_relaxed)) {
+                        if (!wakeup_pending.load(std::memory_order_relaxed)) {
+                            wake_collector();
+                        }
+                    }
+                }
+
                 std::unique_ptr<Block_allocator> block_allocator;
                 std::unique_ptr<Stack_roots_allocator> stack_roots_allocator;
                 std::atomic<bool> is_used = {true};
+                // the thread has ended and the data waits for the next thread, see SGCL_THREAD_CACHE
+                std::atomic<bool> is_cached = {false};
                 std::atomic<int64_t> alloc_count = {0};
                 std::atomic<int64_t> alloc_size = {0};
+                // the collector is woken up when the counters reach the limits, set before it sleeps
+                std::atomic<int64_t> wakeup_count = {0};
+                std::atomic<int64_t> wakeup_size = {0};
+                // the pin epoch of the thread (0 - not pinned), see pin_guard
+                std::atomic<uint64_t> pin_epoch = {0};
                 Data* next = {nullptr};
                 Data* next_unused = {nullptr};
+#if SGCL_GENERATIONAL
+                std::vector<const void*> remembered_slots;
+                std::atomic_flag remembered_lock = ATOMIC_FLAG_INIT;
+
+                // the holder may be preempted, e.g. the collector taking the slots
+                void lock_remembered() noexcept {
+                    while (remembered_lock.test_and_set(std::memory_order_acquire)) {
+                        std::this_thread::yield();
+                    }
+                }
+
+                void unlock_remembered() noexcept {
+                    remembered_lock.clear(std::memory_order_release);
+                }
+#endif
             };
 
             struct Child_pointers {
@@ -40,24 +83,41 @@ namespace sgcl {
                 Priv::Child_pointers::Map* map;
             };
 
-            static constexpr size_t TypePageCount = 64;
-            static constexpr size_t TypePageSize = MaxTypeNumber / TypePageCount;
+            static constexpr size_t TypePageSize = 64;
+
+            // grows with the number of types, the pages of allocators are not moved
+            using Allocators = std::vector<std::unique_ptr<std::array<std::unique_ptr<Object_allocator>, TypePageSize>>>;
+
+            // the allocators and pages of an arena scope, small objects of the thread are allocated
+            // on the pages until the scope ends; the pages of a page pool scope belong to the pool
+            struct Arena {
+                Arena* previous = {nullptr};
+                Page* pages = {nullptr};
+                Page_pool* pool = {nullptr};
+                Allocators allocators;
+            };
+
+            // the state of a thread passed to the next started thread, the data stays in the list
+            // of threads, so the roots allocators, the allocators and their pages are reused
+            struct State {
+                Data* data = {nullptr};
+                std::unique_ptr<Heap_roots_allocator> heap_roots_allocator;
+                Allocators allocators;
+                State* next = {nullptr};
+            };
 
             Thread()
-                : stack_roots_allocator(new Stack_roots_allocator)
-                , heap_roots_allocator(new Heap_roots_allocator)
-                , _block_allocator(new Block_allocator)
-                , _data(new Data{_block_allocator, stack_roots_allocator}){
-#if SGCL_LOG_PRINT_LEVEL >= 3
-                std::cout << "[sgcl] start thread id: " << std::this_thread::get_id() << std::endl;
-#endif
-                _data->next = threads_data.load(std::memory_order_acquire);
-                while(!threads_data.compare_exchange_weak(_data->next, _data, std::memory_order_release, std::memory_order_relaxed));
+                : Thread(_take_state()) {
             }
 
             ~Thread() {
-                _data->is_used.store(false, std::memory_order_release);
-                if (std::this_thread::get_id() == main_thread_id) {
+                current_stack_roots = nullptr;
+                allocation_data = nullptr;
+                bool main_thread = std::this_thread::get_id() == main_thread_id;
+                if (main_thread || !_cache_state()) {
+                    _data->is_used.store(false, std::memory_order_release);
+                }
+                if (main_thread) {
                     Terminate_collector();
                 }
 #if SGCL_LOG_PRINT_LEVEL >= 3
@@ -71,16 +131,27 @@ namespace sgcl {
                 using Type = typename Info::type;
                 if constexpr(std::is_same_v<typename Info::Object_allocator, Small_object_allocator<Type>>) {
                     static unsigned index = _type_index++;
-                    assert(index < MaxTypeNumber);
-                    auto& allocators = _allocators[index / TypePageSize];
+                    auto& table = _arena ? _arena->allocators : _allocators;
+                    if (index / TypePageSize >= table.size()) {
+                        table.resize(index / TypePageSize + 1);
+                    }
+                    auto& allocators = table[index / TypePageSize];
                     if (!allocators) {
                         allocators.reset(new std::array<std::unique_ptr<Object_allocator>, TypePageSize>);
                     }
                     auto& alocator = (*allocators)[index % TypePageSize];
                     if (!alocator) {
-                        alocator.reset(new Small_object_allocator<Type>(*_block_allocator));
+                        if (_arena && _arena->pool) {
+                            alocator.reset(new Small_object_allocator<Type>(*_block_allocator, nullptr, &_arena->pool->buffer(Info::private_metadata())));
+                        } else {
+                            alocator.reset(new Small_object_allocator<Type>(*_block_allocator, _arena ? &_arena->pages : nullptr));
+                        }
+                    }
+                    auto& allocator = static_cast<Small_object_allocator<Type>&>(*alocator);
+                    if (!_arena) {
+                        current_allocator<T> = &allocator;
                     }
-                    return static_cast<Small_object_allocator<Type>&>(*alocator);
+                    return allocator;
                 }
                 else {
                     static Large_object_allocator<Type> allocator;
@@ -88,19 +159,107 @@ namespace sgcl {
                 }
             }
 
-            void update_allocated(size_t s) {
-                auto v = _data->alloc_count.load(std::memory_order_relaxed);
-                _data->alloc_count.store(v + 1, std::memory_order_relaxed);
-                v = _data->alloc_size.load(std::memory_order_relaxed);
-                _data->alloc_size.store(v + s, std::memory_order_relaxed);
+            Data& data() noexcept {
+                return *_data;
+            }
+
+            Block_allocator& block_allocator() noexcept {
+                return *_block_allocator;
+            }
+
+            void update_allocated(size_t s, size_t n = 1) {
+                _data->update_allocated(s, n);
+            }
+
+            void enter_arena(Arena& arena) noexcept {
+                arena.previous = _arena;
+                _arena = &arena;
+                allocation_data = nullptr;
+            }
+
+            // the allocators return their unused places, then the pages are passed to the collector
+            void leave_arena(Arena& arena) noexcept {
+                assert(_arena == &arena);
+                _arena = arena.previous;
+                if (!_arena) {
+                    allocation_data = _data;
+                }
+                arena.allocators.clear();
+                if (arena.pages) {
+                    auto last = arena.pages;
+                    while(last->next_arena) {
+                        last = last->next_arena;
+                    }
+                    last->next_arena = arena_pages.load(std::memory_order_relaxed);
+                    while(!arena_pages.compare_exchange_weak(last->next_arena, arena.pages, std::memory_order_release, std::memory_order_relaxed));
+                    arena.pages = nullptr;
+                }
+            }
+
+            void pin() noexcept {
+                if (!_pin_count++) {
+                    _data->pin_epoch.store(pin_epoch.load(std::memory_order_acquire), std::memory_order_seq_cst);
+                }
+            }
+
+            void unpin() noexcept {
+                assert(_pin_count);
+                if (!--_pin_count) {
+                    // seq_cst pairs with pin_waiting, a parked collector is woken or sees the release
+                    _data->pin_epoch.store(0, std::memory_order_seq_cst);
+                    if (pin_waiting.load(std::memory_order_seq_cst)) {
+                        {
+                            std::lock_guard<std::mutex> lock(pin_mutex);
+                        }
+                        pin_cv.notify_all();
+                    }
+                }
+            }
+
+            static void wake_collector() noexcept {
+                {
+                    std::lock_guard<std::mutex> lock(wakeup_mutex);
+                    wakeup_pending.store(true, std::memory_order_relaxed);
+                }
+                wakeup_cv.notify_one();
+            }
+
+#if SGCL_GENERATIONAL
+            // slots that may hold old to young edges, the collector looks up their owners
+            void remember(const void* slot) {
+                _data->lock_remembered();
+                _data->remembered_slots.emplace_back(slot);
+                _data->unlock_remembered();
             }
+#endif
 
             Child_pointers child_pointers = {0, nullptr};
+#if SGCL_PROFILER
+            int64_t profiler_countdown = {(int64_t)Profiler::rate()};
+#endif
             inline static std::atomic<Data*> threads_data = {nullptr};
             inline static std::thread::id main_thread_id = {};
+            inline static std::mutex wakeup_mutex;
+            inline static std::condition_variable wakeup_cv;
+            inline static std::atomic<bool> wakeup_pending = {false};
+            // the pages of ended arena scopes
+            inline static std::atomic<Page*> arena_pages = {nullptr};
+            // incremented by the collector at the end of marking
+            inline static std::atomic<uint64_t> pin_epoch = {1};
+            // the collector parks on pin_cv while it waits for older pins
+            inline static std::mutex pin_mutex;
+            inline static std::condition_variable pin_cv;
+            inline static std::atomic<bool> pin_waiting = {false};
+            // constant initialized, so it is read without the guard of the thread instance
+            inline static thread_local Stack_roots_allocator* current_stack_roots = {nullptr};
+            // the allocations of small objects take the cached allocators of their types without the
+            // thread instance while the data is set, that is out of arena scopes; see Current_allocator()
+            inline static thread_local Data* allocation_data = {nullptr};
+            template<class T>
+            inline static thread_local Small_object_allocator<typename Type_info<T>::type>* current_allocator = {nullptr};
 
             Stack_roots_allocator* const stack_roots_allocator;
-            const std::unique_ptr<Heap_roots_allocator> heap_roots_allocator;
+            std::unique_ptr<Heap_roots_allocator> heap_roots_allocator;
 
             struct Range_guard {
                 Range_guard(const Range_guard&) = delete;
@@ -125,10 +284,71 @@ namespace sgcl {
             }
 
         private:
+            explicit Thread(std::unique_ptr<State> state)
+                : stack_roots_allocator(state->data->stack_roots_allocator.get())
+                , heap_roots_allocator(std::move(state->heap_roots_allocator))
+                , _block_allocator(state->data->block_allocator.get())
+                , _allocators(std::move(state->allocators))
+                , _data(state->data)
+                , _state(std::move(state)) {
+#if SGCL_LOG_PRINT_LEVEL >= 3
+                std::cout << "[sgcl] start thread id: " << std::this_thread::get_id() << std::endl;
+#endif
+                current_stack_roots = stack_roots_allocator;
+                allocation_data = _data;
+            }
+
+            static std::unique_ptr<State> _take_state() {
+#if SGCL_THREAD_CACHE
+                {
+                    std::lock_guard<std::mutex> lock(_states_mutex);
+                    if (_cached_states) {
+                        std::unique_ptr<State> state(_cached_states);
+                        _cached_states = state->next;
+                        --_cached_count;
+                        state->data->is_cached.store(false, std::memory_order_relaxed);
+                        return state;
+                    }
+                }
+#endif
+                std::unique_ptr<State> state(new State);
+                state->heap_roots_allocator.reset(new Heap_roots_allocator);
+                state->data = new Data{new Block_allocator, new Stack_roots_allocator};
+                auto data = state->data;
+                data->next = threads_data.load(std::memory_order_acquire);
+                while(!threads_data.compare_exchange_weak(data->next, data, std::memory_order_release, std::memory_order_relaxed));
+                return state;
+            }
+
+            // returns false if the cache is full, then the state is released
+            bool _cache_state() noexcept {
+#if SGCL_THREAD_CACHE
+                if (!_arena) {
+                    std::lock_guard<std::mutex> lock(_states_mutex);
+                    if (_cached_count < SGCL_THREAD_CACHE) {
+                        _state->heap_roots_allocator = std::move(heap_roots_allocator);
+                        _state->allocators = std::move(_allocators);
+                        _state->next = _cached_states;
+                        _data->is_cached.store(true, std::memory_order_relaxed);
+                        _cached_states = _state.release();
+                        ++_cached_count;
+                        return true;
+                    }
+                }
+#endif
+                return false;
+            }
+
             Block_allocator* const _block_allocator;
-            std::array<std::unique_ptr<std::array<std::unique_ptr<Object_allocator>, TypePageSize>>, TypePageCount> _allocators;
+            Allocators _allocators;
+            Arena* _arena = {nullptr};
+            unsigned _pin_count = {0};
             Data* const _data;
+            std::unique_ptr<State> _state;
             inline static std::atomic<int> _type_index = {0};
+            inline static std::mutex _states_mutex;
+            inline static State* _cached_states = {nullptr};
+            inline static unsigned _cached_count = {0};
         };
 
         struct Main_thread_detector {
@@ -143,5 +363,31 @@ namespace sgcl {
             static thread_local Thread instance;
             return instance;
         }
+
+        // the stack roots are created and destroyed often, the thread instance is used once per thread
+        inline Stack_roots_allocator& Current_stack_roots() {
+            auto allocator = Thread::current_stack_roots;
+            if (allocator) {
+                return *allocator;
+            }
+            return *Current_thread().stack_roots_allocator;
+        }
+
+        // the allocator of a type and the data of the thread for the counters
+        template<class T>
+        inline auto& Current_allocator(Thread::Data*& data) {
+            using Info = Type_info<T>;
+            if constexpr(std::is_same_v<typename Info::Object_allocator, Small_object_allocator<typename Info::type>>) {
+                data = Thread::allocation_data;
+                auto allocator = Thread::current_allocator<T>;
+                if (data && allocator) {
+                    return *allocator;
+                }
+            }
+            Collector_init();
+            auto& thread = Current_thread();
+            data = &thread.data();
+            return thread.alocator<T>();
+        }
     }
 }
@@ -29,5 +29,25 @@ namespace sgcl {
         private:
             std::chrono::steady_clock::time_point _clock;
         };
+
+        // the time budget of a collector step, see collector::step()
+        struct Deadline {
+            Deadline(double budget) noexcept
+            : _budget(budget) {
+            }
+            bool operator()() noexcept {
+                return _timer.duration() >= _budget;
+            }
+
+        private:
+            Timer _timer;
+            double _budget;
+        };
+
+        struct No_deadline {
+            constexpr bool operator()() const noexcept {
+                return false;
+            }
+        };
     }
 }
@@ -0,0 +1,70 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "../types.h"
+#include "tracked.h"
+#include "types.h"
+
+#include <array>
+#include <type_traits>
+
+namespace sgcl {
+    namespace Priv {
+        template<class T, class = void>
+        struct Is_traced : std::false_type {};
+
+        // the declaration is not inherited, a derived type has to list its own members
+        template<class T>
+        struct Is_traced<T, std::void_t<typename T::sgcl_traced_type>> : std::is_same<T, typename T::sgcl_traced_type> {};
+
+        template<class T>
+        struct Is_tracked_member : std::is_base_of<Tracked, T> {};
+
+        template<class T>
+        struct Is_tracked_member<atomic<T>> : std::is_base_of<Tracked, T> {};
+
+        template<class T>
+        constexpr auto Member_offsets(ptrdiff_t base) noexcept {
+            using Type = std::remove_cv_t<T>;
+            if constexpr(Is_tracked_member<Type>::value) {
+                static_assert(sizeof(Type) == sizeof(Pointer));
+                return std::array<ptrdiff_t, 1>{base};
+            } else if constexpr(std::is_array_v<Type> && std::extent_v<Type> != 0) {
+                using Element = std::remove_extent_t<Type>;
+                constexpr auto element = Member_offsets<Element>(0);
+                std::array<ptrdiff_t, element.size() * std::extent_v<Type>> offsets = {};
+                for (size_t i = 0; i < std::extent_v<Type>; ++i) {
+                    for (size_t j = 0; j < element.size(); ++j) {
+                        offsets[i * element.size() + j] = base + (ptrdiff_t)(i * sizeof(Element)) + element[j];
+                    }
+                }
+                return offsets;
+            } else {
+                static_assert(Is_traced<Type>::value, "[sgcl] SGCL_TRACE: the member is not a tracked pointer and its type does not use SGCL_TRACE");
+                constexpr auto member = Type::sgcl_child_offsets();
+                std::array<ptrdiff_t, member.size()> offsets = {};
+                for (size_t i = 0; i < member.size(); ++i) {
+                    offsets[i] = base + member[i];
+                }
+                return offsets;
+            }
+        }
+
+        template<size_t ...N>
+        constexpr auto Join_offsets(const std::array<ptrdiff_t, N>&... a) noexcept {
+            std::array<ptrdiff_t, (N + ...)> offsets = {};
+            size_t index = 0;
+            auto append = [&](const auto& member) {
+                for (size_t i = 0; i < member.size(); ++i) {
+                    offsets[index++] = member[i];
+                }
+            };
+            (append(a), ...);
+            return offsets;
+        }
+    }
+}
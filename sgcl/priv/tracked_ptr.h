@@ -11,6 +11,7 @@
 #include "thread.h"
 
 #include <cassert>
+#include <cstring>
 
 namespace sgcl {
     namespace Priv {
@@ -98,6 +99,21 @@ namespace sgcl {
                 _force_update(p);
             }
 
+            void force_store(const void* p, const std::memory_order m) noexcept {
+                _ptr.store(const_cast<void*>(p), m);
+                _force_update(p);
+            }
+
+            // called for pointers stored in managed objects, root slots are always traced
+            void remember() const noexcept {
+#if SGCL_GENERATIONAL
+                auto p = _ptr.load(std::memory_order_relaxed);
+                if (p && Page::is_young(p)) {
+                    Current_thread().remember(&_ptr);
+                }
+#endif
+            }
+
             void* exchange(const void* p, const std::memory_order m) noexcept {
                 auto l = _ptr.exchange(const_cast<void*>(p), m);
                 _update(p);
@@ -264,8 +280,12 @@ namespace sgcl {
                             auto array = (Array_base*)Page::base_address_of(p);
                             auto src = (const element_type*)(p);
                             auto dst = Maker<T>::make_tracked(array->count);
-                            for (size_t i = 0; i < array->count; ++i) {
-                                dst[i] = src[i];
+                            if constexpr(std::is_trivially_copyable_v<element_type>) {
+                                std::memcpy((void*)dst.get(), src, sizeof(element_type) * array->count);
+                            } else {
+                                for (size_t i = 0; i < array->count; ++i) {
+                                    dst[i] = src[i];
+                                }
                             }
                             return dst.release();
                         } else {
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <atomic>
+#include <cstddef>
 
 namespace sgcl {    
     namespace Priv {
@@ -30,6 +31,7 @@ namespace sgcl {
         template<class>
         struct Maker;
 
+        struct Mark_queue;
         struct Metadata;
         struct Object_allocator;
         struct Page;
@@ -42,12 +44,17 @@ namespace sgcl {
 
         struct Pointer_pool_base;
 
+        template<size_t>
+        struct Size_class;
+
         template<class>
         struct Small_object_allocator;
 
         struct Small_object_allocator_base;
 
         struct Stack_roots_allocator;
+        struct Stats;
+        struct Sweeper;
         struct Thread;
         struct Timer;
         class Tracked;
@@ -0,0 +1,144 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "page.h"
+#include "types.h"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+namespace sgcl {
+    namespace Priv {
+        struct Weak_slot {
+            Pointer pointer = {nullptr};
+            Weak_slot* next_free = {nullptr};
+        };
+
+        // the pages of slots are aligned to their size, so a slot finds the shard it came from
+        struct alignas(4096) Weak_slot_page {
+            static constexpr unsigned SlotCount = (4096 - sizeof(void*) * 2) / sizeof(Weak_slot);
+
+            Weak_slot_page* next = {nullptr};
+            unsigned shard = {0};
+            Weak_slot slots[SlotCount];
+        };
+
+        struct alignas(64) Weak_slot_shard {
+            std::mutex mutex;
+            Weak_slot* free_slots = {nullptr};
+            // pages are only added, so the collector walks them without the lock
+            std::atomic<Weak_slot_page*> pages = {nullptr};
+            std::atomic<size_t> used = {0};
+        };
+
+        // the slots of weak pointers, not traced by the collector; the slots of objects that are not marked
+        // are cleared after marking and before the sweep, see Collector::_clear_weak_references(); a thread
+        // takes slots from its own shard, so threads creating weak pointers do not contend on one lock,
+        // and the collector scans the slots without blocking them
+        struct Weak_table {
+            static constexpr unsigned ShardCount = 64;
+
+            using Slot = Weak_slot;
+
+            static Slot* alloc(const void* p) {
+                auto index = _thread_shard;
+                auto& shard = _shards[index];
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                if (!shard.free_slots) {
+                    auto page = new Weak_slot_page;
+                    page->shard = index;
+                    for (auto& slot : page->slots) {
+                        slot.next_free = shard.free_slots;
+                        shard.free_slots = &slot;
+                    }
+                    page->next = shard.pages.load(std::memory_order_relaxed);
+                    shard.pages.store(page, std::memory_order_release);
+                }
+                auto slot = shard.free_slots;
+                shard.free_slots = slot->next_free;
+                slot->pointer.store(const_cast<void*>(p), std::memory_order_release);
+                shard.used.fetch_add(1, std::memory_order_relaxed);
+                return slot;
+            }
+
+            // the slot goes back to the shard it came from
+            static void free(Slot* slot) noexcept {
+                auto page = (Weak_slot_page*)((uintptr_t)slot & ~(uintptr_t)(alignof(Weak_slot_page) - 1));
+                auto& shard = _shards[page->shard];
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                slot->pointer.store(nullptr, std::memory_order_relaxed);
+                slot->next_free = shard.free_slots;
+                shard.free_slots = slot;
+                shard.used.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            // called within a pin; while the collector clears the slots, the objects that
+            // are registered and not marked are seen as unreachable
+            static void* load(const Slot* slot) noexcept {
+                if (!slot) {
+                    return nullptr;
+                }
+                auto p = slot->pointer.load(std::memory_order_acquire);
+                if (p && clearing.load(std::memory_order_seq_cst) && !Page::is_marked(p)) {
+                    return nullptr;
+                }
+                return p;
+            }
+
+            static bool is_used() noexcept {
+                for (auto& shard : _shards) {
+                    if (shard.used.load(std::memory_order_relaxed)) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            // visits the pointers of the used slots, the pointers are atomic and the pages are
+            // never freed, so no lock is taken
+            template<class F>
+            static void for_each(F&& f) {
+                for (auto& shard : _shards) {
+                    for (auto page = shard.pages.load(std::memory_order_acquire); page; page = page->next) {
+                        for (auto& slot : page->slots) {
+                            if (slot.pointer.load(std::memory_order_relaxed)) {
+                                f(slot.pointer);
+                            }
+                        }
+                    }
+                }
+            }
+
+            static void set_callback(std::function<void(size_t)> callback) {
+                std::lock_guard<std::mutex> lock(_callback_mutex);
+                _callback = std::move(callback);
+            }
+
+            static void report_cleared(size_t count) {
+                std::function<void(size_t)> callback;
+                {
+                    std::lock_guard<std::mutex> lock(_callback_mutex);
+                    callback = _callback;
+                }
+                if (callback) {
+                    callback(count);
+                }
+            }
+
+            inline static std::atomic<bool> clearing = {false};
+
+        private:
+            inline static std::array<Weak_slot_shard, ShardCount> _shards;
+            inline static std::atomic<unsigned> _next_shard = {0};
+            inline static thread_local unsigned _thread_shard = _next_shard.fetch_add(1, std::memory_order_relaxed) % ShardCount;
+            inline static std::mutex _callback_mutex;
+            inline static std::function<void(size_t)> _callback;
+        };
+    }
+}
@@ -0,0 +1,52 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "priv/root_blocks.h"
+#include "tracked_ptr.h"
+#include "types.h"
+
+#include <tuple>
+
+namespace sgcl {
+    // roots of the given types registered with the collector as one block, so they take no root slots
+    // of their own and are not found by their addresses; meant for objects on the heap that hold roots
+    // and are created often, e.g. the frames of coroutines as a local or a base of the promise type,
+    // which can be resumed on any thread
+    template<class... T>
+    class root_block : Priv::Root_block {
+        static_assert(sizeof...(T) > 0, "root_block without roots");
+
+        template<size_t I>
+        using Type = std::tuple_element_t<I, std::tuple<T...>>;
+
+    public:
+        root_block()
+        : Priv::Root_block{_pointers, sizeof...(T)} {
+            Priv::Root_blocks::add(this);
+        }
+
+        root_block(const root_block&) = delete;
+        root_block& operator=(const root_block&) = delete;
+
+        ~root_block() {
+            Priv::Root_blocks::remove(this);
+        }
+
+        template<size_t I>
+        tracked_ptr<Type<I>>& get() noexcept {
+            return reinterpret_cast<tracked_ptr<Type<I>>&>(_pointers[I]);
+        }
+
+        template<size_t I>
+        const tracked_ptr<Type<I>>& get() const noexcept {
+            return reinterpret_cast<const tracked_ptr<Type<I>>&>(_pointers[I]);
+        }
+
+    private:
+        Priv::Pointer _pointers[sizeof...(T)] = {};
+    };
+}
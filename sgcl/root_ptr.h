@@ -18,13 +18,8 @@ namespace sgcl {
     public:
         using element_type = std::remove_extent_t<T>;
 
-        root_ptr() {
-            if (!_stack_detected()) {
-                auto ref = Priv::Current_thread().heap_roots_allocator->alloc();
-                _ref = _set_flag(ref, HeapRootFlag);
-            } else {
-                _ref = Priv::Current_thread().stack_roots_allocator->alloc(this);
-            }
+        root_ptr()
+        : _ref(_stack_detected() ? Priv::Current_stack_roots().alloc(this) : _alloc_heap_root()) {
         }
 
         root_ptr(std::nullptr_t)
@@ -82,8 +77,12 @@ namespace sgcl {
         ~root_ptr() {
             if (_ref) {
                 _ptr().store(nullptr);
-                if (_is_heap_root() && !Priv::Collector::terminated()) {
-                    Priv::Current_thread().heap_roots_allocator->free(_ref);
+                if (!Priv::Collector::terminated()) {
+                    if (_is_heap_root()) {
+                        Priv::Heap_roots_allocator::free(_remove_flags(_ref));
+                    } else {
+                        Priv::Current_stack_roots().free(this, _ref);
+                    }
                 }
             }
         }
@@ -157,7 +156,7 @@ namespace sgcl {
         template <class U = T, std::enable_if_t<std::is_array_v<U>, int> = 0>
         size_t size() const noexcept {
             auto array = (Priv::Array_base*)_ptr().base_address();
-            return array ? array->count : 0;
+            return array ? array->count.load(std::memory_order_acquire) : 0;
         }
 
         template <class U = T, std::enable_if_t<std::is_array_v<U>, int> = 0>
@@ -231,11 +230,16 @@ namespace sgcl {
                     _ref = _set_flag(ref, HeapRootFlag);
                 }
             } else {
-                _ref = Priv::Current_thread().stack_roots_allocator->alloc(this);
+                _ref = Priv::Current_stack_roots().alloc(this);
                 _ref->store(p);
             }
         }
 
+        static Priv::Tracked_ptr* _alloc_heap_root() {
+            auto ref = Priv::Current_thread().heap_roots_allocator->alloc();
+            return _set_flag(ref, HeapRootFlag);
+        }
+
         bool _is_heap_root() const noexcept {
             return (uintptr_t)_ref & HeapRootFlag;
         }
@@ -5,12 +5,29 @@
 //------------------------------------------------------------------------------
 #pragma once
 
+#include "arena_scope.h"
 #include "atomic.h"
 #include "collector.h"
+#include "collector_policy.h"
+#include "collector_stats.h"
+#include "collector_tracer.h"
 #include "configuration.h"
+#include "deep_clone.h"
+#include "ephemeron_map.h"
+#include "heap_snapshot.h"
+#include "latency_histogram.h"
 #include "make_tracked.h"
+#include "memory_resource.h"
+#include "page_pool.h"
+#include "pin_guard.h"
+#include "root_block.h"
 #include "root_ptr.h"
+#include "shutdown_mode.h"
+#include "trace.h"
 #include "tracked_ptr.h"
 #include "unique_deleter.h"
 #include "unique_ptr.h"
+#include "unordered_map.h"
 #include "unsafe_ptr.h"
+#include "vector.h"
+#include "weak_ptr.h"
@@ -0,0 +1,18 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+namespace sgcl {
+    // how the collector ends, see collector::terminate()
+    enum class shutdown_mode {
+        // cycles are run until no more objects are destroyed
+        finalize,
+        // one last cycle runs the destructors of unreachable objects of types with finalize_on_shutdown metadata
+        opted,
+        // no cycle is run and no destructor
+        skip
+    };
+}
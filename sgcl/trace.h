@@ -0,0 +1,57 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "priv/trace.h"
+
+#include <cstddef>
+
+// declares the tracked pointer members of T, the offsets are computed at compile time
+// and the first object of T is not scanned for pointers; members can be tracked_ptr,
+// atomic<tracked_ptr>, arrays of them and types that use SGCL_TRACE, at most 32 members
+// usage: struct node { tracked_ptr<node> left, right; int value; SGCL_TRACE(node, left, right) };
+#define SGCL_TRACE(T, ...) \
+    using sgcl_traced_type = T; \
+    static constexpr auto sgcl_child_offsets() noexcept { \
+        return sgcl::Priv::Join_offsets(SGCL_PRIV_FOR_EACH(SGCL_PRIV_MEMBER_OFFSETS, T, __VA_ARGS__)); \
+    }
+
+#define SGCL_PRIV_MEMBER_OFFSETS(T, m) sgcl::Priv::Member_offsets<decltype(T::m)>(offsetof(T, m))
+#define SGCL_PRIV_EXPAND(x) x
+#define SGCL_PRIV_FOR_EACH_1(F, T, m) F(T, m)
+#define SGCL_PRIV_FOR_EACH_2(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_1(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_3(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_2(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_4(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_3(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_5(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_4(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_6(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_5(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_7(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_6(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_8(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_7(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_9(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_8(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_10(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_9(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_11(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_10(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_12(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_11(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_13(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_12(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_14(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_13(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_15(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_14(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_16(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_15(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_17(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_16(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_18(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_17(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_19(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_18(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_20(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_19(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_21(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_20(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_22(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_21(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_23(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_22(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_24(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_23(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_25(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_24(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_26(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_25(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_27(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_26(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_28(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_27(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_29(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_28(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_30(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_29(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_31(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_30(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_32(F, T, m, ...) F(T, m), SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_31(F, T, __VA_ARGS__))
+#define SGCL_PRIV_FOR_EACH_N(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, N, ...) SGCL_PRIV_FOR_EACH_##N
+#define SGCL_PRIV_FOR_EACH(F, T, ...) SGCL_PRIV_EXPAND(SGCL_PRIV_EXPAND(SGCL_PRIV_FOR_EACH_N(__VA_ARGS__, 32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0))(F, T, __VA_ARGS__))
@@ -61,18 +61,21 @@ namespace sgcl {
 
         tracked_ptr& operator=(const tracked_ptr& p) noexcept {
             _ptr().store(p.get());
+            _ptr().remember();
             return *this;
         }
 
         template<class U, std::enable_if_t<std::is_convertible_v<U*, T*>, int> = 0>
         tracked_ptr& operator=(const root_ptr<U>& p) noexcept {
             _ptr().store(static_cast<element_type*>(p.get()));
+            _ptr().remember();
             return *this;
         }
 
         template<class U, std::enable_if_t<std::is_convertible_v<U*, T*>, int> = 0>
         tracked_ptr& operator=(const tracked_ptr<U>& p) noexcept {
             _ptr().store(static_cast<element_type*>(p.get()));
+            _ptr().remember();
             return *this;
         }
 
@@ -80,12 +83,14 @@ namespace sgcl {
         tracked_ptr& operator=(unique_ptr<U>&& u) noexcept {
             auto p = u.release();
             _ptr().force_store(static_cast<element_type*>(p));
+            _ptr().remember();
             return *this;
         }
 
         template<class U, std::enable_if_t<std::is_convertible_v<U*, T*>, int> = 0>
         tracked_ptr& operator=(const unsafe_ptr<U>& p) noexcept {
             _ptr().store(static_cast<element_type*>(p.get()));
+            _ptr().remember();
             return *this;
         }
 
@@ -114,7 +119,7 @@ namespace sgcl {
         template <class U = T, std::enable_if_t<std::is_array_v<U>, int> = 0>
         size_t size() const noexcept {
             auto array = (Priv::Array_base*)_ptr().base_address();
-            return array ? array->count : 0;
+            return array ? array->count.load(std::memory_order_acquire) : 0;
         }
 
         template <class U = T, std::enable_if_t<std::is_array_v<U>, int> = 0>
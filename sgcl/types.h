@@ -12,6 +12,12 @@ namespace sgcl {
     class atomic;
 
     struct collector;
+    struct collector_pacer;
+    struct collector_pacing;
+    struct collector_policy;
+    struct collector_stats;
+    struct heap_object;
+    struct heap_visitor;
     struct metadata;
     struct metadata_base;
 
@@ -21,6 +27,9 @@ namespace sgcl {
     template<class T, size_t N>
     class tracked_ptr<T[N]>;
 
+    template<class...>
+    class root_block;
+
     template<class>
     class root_ptr;
 
@@ -32,4 +41,10 @@ namespace sgcl {
 
     template<class T, size_t N>
     struct unsafe_ptr<T[N]>;
+
+    template<class>
+    class weak_ptr;
+
+    template<class, class>
+    class ephemeron_map;
 }
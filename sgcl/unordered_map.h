@@ -0,0 +1,388 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "vector.h"
+
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace sgcl {
+    // an open addressing hash map with linear probing, the entries and a byte of control data
+    // per entry are stored in managed arrays; like sgcl::vector it is a member of managed
+    // objects or created with make_tracked, K and V are default constructible
+    template<class K, class V, class Hash = std::hash<K>, class KeyEqual = std::equal_to<K>>
+    class unordered_map {
+    public:
+        using key_type = K;
+        using mapped_type = V;
+        using hasher = Hash;
+        using key_equal = KeyEqual;
+        using size_type = size_t;
+
+        struct value_type {
+            K first;
+            V second;
+        };
+
+        template<class Map, class Value>
+        class basic_iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = Value;
+            using difference_type = ptrdiff_t;
+            using pointer = Value*;
+            using reference = Value&;
+
+            basic_iterator(Map* map, size_t index, size_t stop = NoIndex) noexcept
+            : _map(map)
+            , _index(index)
+            , _stop(stop) {
+                _skip();
+            }
+
+            template<class M, class U>
+            basic_iterator(const basic_iterator<M, U>& i) noexcept
+            : _map(i._map)
+            , _index(i._index)
+            , _stop(i._stop) {
+            }
+
+            Value& operator*() const noexcept {
+                return _map->_entries[_index];
+            }
+
+            Value* operator->() const noexcept {
+                return &_map->_entries[_index];
+            }
+
+            basic_iterator& operator++() noexcept {
+                _next();
+                _skip();
+                return *this;
+            }
+
+            basic_iterator operator++(int) noexcept {
+                auto i = *this;
+                ++*this;
+                return i;
+            }
+
+            bool operator==(const basic_iterator& i) const noexcept {
+                return _index == i._index;
+            }
+
+            bool operator!=(const basic_iterator& i) const noexcept {
+                return _index != i._index;
+            }
+
+        private:
+            // the iteration wraps around and ends at the empty entry it started after
+            void _next() noexcept {
+                if (_stop == NoIndex) {
+                    _stop = _map->_empty_index();
+                }
+                _index = (_index + 1) & (_map->capacity() - 1);
+                if (_index == _stop) {
+                    _index = _map->capacity();
+                }
+            }
+
+            void _skip() noexcept {
+                while (_index < _map->capacity() && !_map->_control[_index]) {
+                    _next();
+                }
+            }
+
+            Map* _map;
+            size_t _index;
+            size_t _stop;
+
+            template<class, class> friend class basic_iterator;
+            friend class unordered_map;
+        };
+
+        using iterator = basic_iterator<unordered_map, value_type>;
+        using const_iterator = basic_iterator<const unordered_map, const value_type>;
+
+        unordered_map() = default;
+
+        unordered_map(const unordered_map& m) {
+            *this = m;
+        }
+
+        unordered_map(unordered_map&& m) noexcept {
+            *this = std::move(m);
+        }
+
+        unordered_map& operator=(const unordered_map& m) {
+            if (this != &m) {
+                clear();
+                reserve(m.size());
+                for (auto& e : m) {
+                    insert_or_assign(e.first, e.second);
+                }
+            }
+            return *this;
+        }
+
+        unordered_map& operator=(unordered_map&& m) noexcept {
+            if (this != &m) {
+                _entries = m._entries;
+                _control = m._control;
+                _size = m._size;
+                m._entries = nullptr;
+                m._control = nullptr;
+                m._size = 0;
+            }
+            return *this;
+        }
+
+        // the iteration starts after an empty entry, backward shift deletion never moves entries
+        // across it, so erasing while iterating neither revisits nor skips entries
+        iterator begin() noexcept {
+            return _begin(this);
+        }
+
+        const_iterator begin() const noexcept {
+            return _begin(this);
+        }
+
+        iterator end() noexcept {
+            return {this, capacity()};
+        }
+
+        const_iterator end() const noexcept {
+            return {this, capacity()};
+        }
+
+        bool empty() const noexcept {
+            return !_size;
+        }
+
+        size_t size() const noexcept {
+            return _size;
+        }
+
+        size_t capacity() const noexcept {
+            return _control.size();
+        }
+
+        void reserve(size_t count) {
+            auto capacity = std::max(this->capacity(), MinCapacity);
+            while (count * MaxLoadDenominator > capacity * MaxLoadNumerator) {
+                capacity *= 2;
+            }
+            if (capacity != this->capacity()) {
+                _rehash(capacity);
+            }
+        }
+
+        void clear() noexcept {
+            for (size_t i = 0; i < capacity(); ++i) {
+                if (_control[i]) {
+                    _reset(i);
+                }
+            }
+            _size = 0;
+        }
+
+        iterator find(const K& key) noexcept {
+            return {this, _find(key)};
+        }
+
+        const_iterator find(const K& key) const noexcept {
+            return {this, _find(key)};
+        }
+
+        size_t count(const K& key) const noexcept {
+            return _find(key) != capacity();
+        }
+
+        bool contains(const K& key) const noexcept {
+            return count(key);
+        }
+
+        V& at(const K& key) {
+            auto index = _find(key);
+            if (index == capacity()) {
+                throw std::out_of_range("sgcl::unordered_map::at");
+            }
+            return _entries[index].second;
+        }
+
+        const V& at(const K& key) const {
+            auto index = _find(key);
+            if (index == capacity()) {
+                throw std::out_of_range("sgcl::unordered_map::at");
+            }
+            return _entries[index].second;
+        }
+
+        V& operator[](const K& key) {
+            return _insert(key).first->second;
+        }
+
+        // the value is assigned, so root_ptr or unique_ptr can be stored in unordered_map<K, tracked_ptr>
+        template<class U>
+        std::pair<iterator, bool> insert(const K& key, U&& value) {
+            auto result = _insert(key);
+            if (result.second) {
+                result.first->second = std::forward<U>(value);
+            }
+            return result;
+        }
+
+        template<class U>
+        std::pair<iterator, bool> insert_or_assign(const K& key, U&& value) {
+            auto result = _insert(key);
+            result.first->second = std::forward<U>(value);
+            return result;
+        }
+
+        size_t erase(const K& key) noexcept {
+            auto index = _find(key);
+            if (index == capacity()) {
+                return 0;
+            }
+            _erase(index);
+            return 1;
+        }
+
+        iterator erase(const_iterator pos) noexcept {
+            auto index = pos._index;
+            _erase(index);
+            // an entry from behind may have been moved to the index
+            return {this, index, pos._stop};
+        }
+
+    private:
+        static constexpr size_t MinCapacity = 8;
+        static constexpr size_t MaxLoadNumerator = 7;
+        static constexpr size_t MaxLoadDenominator = 8;
+        static constexpr size_t NoIndex = size_t(-1);
+
+        template<class Map>
+        static basic_iterator<Map, std::conditional_t<std::is_const_v<Map>, const value_type, value_type>> _begin(Map* map) noexcept {
+            if (!map->_size) {
+                return {map, map->capacity()};
+            }
+            auto stop = map->_empty_index();
+            return {map, (stop + 1) & (map->capacity() - 1), stop};
+        }
+
+        // the load factor keeps at least one entry empty
+        size_t _empty_index() const noexcept {
+            size_t index = 0;
+            while (_control[index]) {
+                ++index;
+            }
+            return index;
+        }
+
+        // the low bits of std::hash are often poor, pointers are aligned and integers map to themselves
+        static size_t _hash_of(const K& key) noexcept {
+            auto hash = (uint64_t)Hash()(key) * 0x9E3779B97F4A7C15ull;
+            return size_t(hash ^ (hash >> 32));
+        }
+
+        // the control byte of a used entry keeps 7 bits of the hash, 0 marks an empty entry
+        static uint8_t _control_of(size_t hash) noexcept {
+            return uint8_t(0x80 | (hash >> (sizeof(size_t) * 8 - 7)));
+        }
+
+        size_t _home_of(size_t hash) const noexcept {
+            return hash & (capacity() - 1);
+        }
+
+        size_t _find(const K& key) const noexcept {
+            if (!_size) {
+                return capacity();
+            }
+            auto hash = _hash_of(key);
+            auto control = _control_of(hash);
+            auto mask = capacity() - 1;
+            for (auto index = _home_of(hash);; index = (index + 1) & mask) {
+                auto c = _control[index];
+                if (!c) {
+                    return capacity();
+                }
+                if (c == control && KeyEqual()(_entries[index].first, key)) {
+                    return index;
+                }
+            }
+        }
+
+        std::pair<iterator, bool> _insert(const K& key) {
+            auto index = _find(key);
+            if (index != capacity()) {
+                return {{this, index}, false};
+            }
+            reserve(_size + 1);
+            auto hash = _hash_of(key);
+            auto mask = capacity() - 1;
+            index = _home_of(hash);
+            while (_control[index]) {
+                index = (index + 1) & mask;
+            }
+            _entries[index].first = key;
+            _control[index] = _control_of(hash);
+            ++_size;
+            return {{this, index}, true};
+        }
+
+        // backward shift deletion, the probe sequences stay without gaps
+        void _erase(size_t index) noexcept {
+            auto mask = capacity() - 1;
+            auto next = (index + 1) & mask;
+            while (_control[next]) {
+                auto home = _home_of(_hash_of(_entries[next].first));
+                if (((next - home) & mask) >= ((next - index) & mask)) {
+                    _entries[index].first = std::move(_entries[next].first);
+                    _entries[index].second = std::move(_entries[next].second);
+                    _control[index] = _control[next];
+                    index = next;
+                }
+                next = (next + 1) & mask;
+            }
+            _reset(index);
+            --_size;
+        }
+
+        void _reset(size_t index) noexcept {
+            Priv::Reset_element(_entries[index].first);
+            Priv::Reset_element(_entries[index].second);
+            _control[index] = 0;
+        }
+
+        void _rehash(size_t capacity) {
+            auto entries = make_tracked<value_type[]>(capacity);
+            auto control = make_tracked<uint8_t[]>(capacity, uint8_t(0));
+            auto mask = capacity - 1;
+            for (size_t i = 0; i < this->capacity(); ++i) {
+                if (_control[i]) {
+                    auto hash = _hash_of(_entries[i].first);
+                    auto index = hash & mask;
+                    while (control[index]) {
+                        index = (index + 1) & mask;
+                    }
+                    entries[index].first = std::move(_entries[i].first);
+                    entries[index].second = std::move(_entries[i].second);
+                    control[index] = _control_of(hash);
+                }
+            }
+            _entries = std::move(entries);
+            _control = std::move(control);
+        }
+
+        tracked_ptr<value_type[]> _entries;
+        tracked_ptr<uint8_t[]> _control;
+        size_t _size = {0};
+    };
+}
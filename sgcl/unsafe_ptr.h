@@ -17,6 +17,7 @@ namespace sgcl {
 
         constexpr unsafe_ptr() = delete;
         unsafe_ptr(const unsafe_ptr& p) = default;
+        unsafe_ptr& operator=(const unsafe_ptr& p) = default;
 
         template<class U, std::enable_if_t<std::is_convertible_v<U*, T*>, int> = 0>
         unsafe_ptr(const unsafe_ptr<U>& p)
@@ -58,7 +59,7 @@ namespace sgcl {
         template <class U = T, std::enable_if_t<std::is_array_v<U>, int> = 0>
         size_t size() const noexcept {
             auto array = (Priv::Array_base*)Priv::Tracked_ptr::base_address_of(_ptr);
-            return array ? array->count : 0;
+            return array ? array->count.load(std::memory_order_acquire) : 0;
         }
 
         template <class U = T, std::enable_if_t<std::is_array_v<U>, int> = 0>
@@ -107,7 +108,13 @@ namespace sgcl {
         }
 
     private:
-        element_type* const _ptr;
+        explicit unsafe_ptr(element_type* p) noexcept
+        : _ptr(p) {
+        }
+
+        element_type* _ptr;
+
+        template<class> friend class atomic;
     };
 
     template<class T, class U>
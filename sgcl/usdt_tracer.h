@@ -0,0 +1,24 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "collector_tracer.h"
+
+#include <sys/sdt.h>
+
+namespace sgcl {
+    // USDT probes sgcl:phase__begin(phase) and sgcl:phase__end(phase, objects, pages), the phase
+    // is the index of collector_phase; e.g. bpftrace -e 'usdt:./app:sgcl:phase__end { @[arg0] = hist(arg1); }'
+    struct usdt_tracer : collector_tracer {
+        void begin(collector_phase phase) noexcept override {
+            DTRACE_PROBE1(sgcl, phase__begin, (int)phase);
+        }
+
+        void end(collector_phase phase, int64_t objects, int64_t pages) noexcept override {
+            DTRACE_PROBE3(sgcl, phase__end, (int)phase, objects, pages);
+        }
+    };
+}
@@ -0,0 +1,351 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "make_tracked.h"
+#include "root_ptr.h"
+#include "tracked_ptr.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+
+namespace sgcl {
+    namespace Priv {
+        // elements are not copied through temporaries, a tracked_ptr cannot live on the stack
+        template<class T>
+        void Reset_element(T& e) noexcept {
+            if constexpr(std::is_assignable_v<T&, std::nullptr_t>) {
+                e = nullptr;
+            } else {
+                e = T();
+            }
+        }
+    }
+
+    // a growable array stored in a managed array, the marker scans the elements contiguously;
+    // like tracked_ptr it is a member of managed objects or created with make_tracked,
+    // the elements past the size stay default constructed, T is default constructible;
+    // values are assigned to the elements, so root_ptr or unique_ptr can be pushed to vector<tracked_ptr>
+    template<class T>
+    class vector {
+    public:
+        using value_type = T;
+        using size_type = size_t;
+        using difference_type = ptrdiff_t;
+        using reference = T&;
+        using const_reference = const T&;
+        using pointer = T*;
+        using const_pointer = const T*;
+        using iterator = T*;
+        using const_iterator = const T*;
+
+        vector() = default;
+
+        explicit vector(size_t count) {
+            resize(count);
+        }
+
+        template<class U>
+        vector(size_t count, const U& value) {
+            resize(count, value);
+        }
+
+        vector(const vector& v) {
+            *this = v;
+        }
+
+        vector(vector&& v) noexcept {
+            *this = std::move(v);
+        }
+
+        vector& operator=(const vector& v) {
+            if (this != &v) {
+                clear();
+                reserve(v.size());
+                for (auto& e : v) {
+                    push_back(e);
+                }
+            }
+            return *this;
+        }
+
+        vector& operator=(vector&& v) noexcept {
+            if (this != &v) {
+                _data = v._data;
+                _size = v._size;
+                v._data = nullptr;
+                v._size = 0;
+            }
+            return *this;
+        }
+
+        T& operator[](size_t i) noexcept {
+            assert(i < _size);
+            return _data[i];
+        }
+
+        const T& operator[](size_t i) const noexcept {
+            assert(i < _size);
+            return _data[i];
+        }
+
+        T& at(size_t i) {
+            if (i >= _size) {
+                throw std::out_of_range("sgcl::vector::at");
+            }
+            return _data[i];
+        }
+
+        const T& at(size_t i) const {
+            if (i >= _size) {
+                throw std::out_of_range("sgcl::vector::at");
+            }
+            return _data[i];
+        }
+
+        T& front() noexcept {
+            return (*this)[0];
+        }
+
+        const T& front() const noexcept {
+            return (*this)[0];
+        }
+
+        T& back() noexcept {
+            return (*this)[_size - 1];
+        }
+
+        const T& back() const noexcept {
+            return (*this)[_size - 1];
+        }
+
+        T* data() noexcept {
+            return _data.get();
+        }
+
+        const T* data() const noexcept {
+            return _data.get();
+        }
+
+        iterator begin() noexcept {
+            return _data.get();
+        }
+
+        const_iterator begin() const noexcept {
+            return _data.get();
+        }
+
+        iterator end() noexcept {
+            return begin() + _size;
+        }
+
+        const_iterator end() const noexcept {
+            return begin() + _size;
+        }
+
+        bool empty() const noexcept {
+            return !_size;
+        }
+
+        size_t size() const noexcept {
+            return _size;
+        }
+
+        size_t capacity() const noexcept {
+            return _data.size();
+        }
+
+        void reserve(size_t count) {
+            if (count > capacity()) {
+                _reallocate(count);
+            }
+        }
+
+        void shrink_to_fit() {
+            if (_size < capacity()) {
+                if (_size) {
+                    _reallocate(_size);
+                } else {
+                    _data = nullptr;
+                }
+            }
+        }
+
+        void clear() noexcept {
+            for (size_t i = 0; i < _size; ++i) {
+                Priv::Reset_element(_data[i]);
+            }
+            _size = 0;
+        }
+
+        template<class U>
+        void push_back(U&& value) {
+            if (_size == capacity()) {
+                _grow(std::forward<U>(value));
+            } else {
+                _data[_size] = std::forward<U>(value);
+            }
+            ++_size;
+        }
+
+        // the default constructed element past the size, T(a...) is a temporary for other arguments
+        template<class ...A>
+        T& emplace_back(A&&... a) {
+            if constexpr(sizeof...(A) == 0) {
+                if (_size == capacity()) {
+                    _reallocate(std::max(capacity() * 2, MinCapacity));
+                }
+            } else if constexpr(sizeof...(A) == 1) {
+                push_back(std::forward<A>(a)...);
+                return back();
+            } else {
+                push_back(T(std::forward<A>(a)...));
+                return back();
+            }
+            return _data[_size++];
+        }
+
+        void pop_back() noexcept {
+            assert(_size);
+            Priv::Reset_element(_data[--_size]);
+        }
+
+        template<class U>
+        iterator insert(const_iterator pos, U&& value) {
+            auto index = pos - begin();
+            if (index == (ptrdiff_t)_size) {
+                push_back(std::forward<U>(value));
+            } else {
+                // the value can be an element of this vector, it is read by its index after the shift
+                auto alias = _index_of(value);
+                push_back(back());
+                std::move_backward(begin() + index, end() - 2, end() - 1);
+                if (alias == NoIndex) {
+                    _data[index] = std::forward<U>(value);
+                } else {
+                    auto& element = _data[alias >= (size_t)index ? alias + 1 : alias];
+                    if constexpr(std::is_lvalue_reference_v<U>) {
+                        _data[index] = element;
+                    } else {
+                        _data[index] = std::move(element);
+                    }
+                }
+            }
+            return begin() + index;
+        }
+
+        iterator erase(const_iterator pos) {
+            return erase(pos, pos + 1);
+        }
+
+        iterator erase(const_iterator first, const_iterator last) {
+            auto index = first - begin();
+            auto count = last - first;
+            std::move(begin() + index + count, end(), begin() + index);
+            for (auto i = _size - count; i < _size; ++i) {
+                Priv::Reset_element(_data[i]);
+            }
+            _size -= count;
+            return begin() + index;
+        }
+
+        void resize(size_t count) {
+            if (count > _size) {
+                reserve(count);
+            } else {
+                for (size_t i = count; i < _size; ++i) {
+                    Priv::Reset_element(_data[i]);
+                }
+            }
+            _size = count;
+        }
+
+        template<class U>
+        void resize(size_t count, const U& value) {
+            auto size = _size;
+            resize(count);
+            if (count > size) {
+                std::fill(begin() + size, end(), value);
+            }
+        }
+
+        void swap(vector& v) noexcept {
+            root_ptr<T[]> data = _data;
+            _data = v._data;
+            v._data = data;
+            std::swap(_size, v._size);
+        }
+
+    private:
+        static constexpr size_t MinCapacity = 4;
+
+        // arrays of trivial types are not initialized by make_tracked, the elements
+        // from the given index are value initialized, the ones before are overwritten
+        static auto _allocate(size_t count, size_t index) {
+            if constexpr(std::is_trivial_v<T>) {
+                auto data = make_tracked_for_overwrite<T[]>(count);
+                std::fill(data.get() + index, data.get() + count, T());
+                return data;
+            } else {
+                return make_tracked<T[]>(count);
+            }
+        }
+
+        // a large array grows in place, its elements are not moved
+        bool _grow_in_place(size_t count) {
+            auto capacity = this->capacity();
+            if (!capacity || !Priv::Maker<T[]>::grow(_data.get(), count)) {
+                return false;
+            }
+            if constexpr(std::is_trivial_v<T>) {
+                std::fill(begin() + capacity, begin() + count, T());
+            }
+            return true;
+        }
+
+        static constexpr size_t NoIndex = size_t(-1);
+
+        template<class U>
+        size_t _index_of(const U& value) const noexcept {
+            if constexpr(std::is_same_v<std::decay_t<U>, T>) {
+                auto p = std::addressof(value);
+                if (!std::less<const T*>()(p, begin()) && std::less<const T*>()(p, end())) {
+                    return p - begin();
+                }
+            }
+            return NoIndex;
+        }
+
+        // the value can be an element of this vector, it is stored before the old array is released
+        template<class U>
+        void _grow(U&& value) {
+            auto capacity = std::max(this->capacity() * 2, MinCapacity);
+            if (_grow_in_place(capacity)) {
+                _data[_size] = std::forward<U>(value);
+                return;
+            }
+            auto data = _allocate(capacity, _size);
+            data[_size] = std::forward<U>(value);
+            std::move(begin(), end(), data.get());
+            _data = std::move(data);
+        }
+
+        void _reallocate(size_t count) {
+            if (count > capacity() && _grow_in_place(count)) {
+                return;
+            }
+            auto data = _allocate(count, _size);
+            std::move(begin(), end(), data.get());
+            _data = std::move(data);
+        }
+
+        tracked_ptr<T[]> _data;
+        size_t _size = {0};
+    };
+}
@@ -0,0 +1,134 @@
+//------------------------------------------------------------------------------
+// SGCL: Smart Garbage Collection Library
+// Copyright (c) 2022-2024 Sebastian Nibisz
+// SPDX-License-Identifier: Zlib
+//------------------------------------------------------------------------------
+#pragma once
+
+#include "priv/weak_table.h"
+#include "pin_guard.h"
+#include "root_ptr.h"
+#include "tracked_ptr.h"
+#include "types.h"
+
+#include <utility>
+
+namespace sgcl {
+    // does not keep the object alive; the collector clears the pointer once the object is unreachable,
+    // before it is swept, see collector::set_weak_callback(); a weak pointer is not traced, so it
+    // can be stored outside of tracked objects, e.g. in the keys of caches
+    template<class T>
+    class weak_ptr {
+        static_assert(!std::is_array_v<T>, "weak_ptr of arrays is not supported");
+        using Weak_table = Priv::Weak_table;
+
+    public:
+        using element_type = T;
+
+        constexpr weak_ptr() noexcept = default;
+
+        constexpr weak_ptr(std::nullptr_t) noexcept {
+        }
+
+        template<class U, std::enable_if_t<std::is_convertible_v<U*, T*>, int> = 0>
+        weak_ptr(const root_ptr<U>& p) {
+            _set(static_cast<T*>(p.get()));
+        }
+
+        template<class U, std::enable_if_t<std::is_convertible_v<U*, T*>, int> = 0>
+        weak_ptr(const tracked_ptr<U>& p) {
+            _set(static_cast<T*>(p.get()));
+        }
+
+        weak_ptr(const weak_ptr& p) {
+            pin_guard guard;
+            _set(p._load());
+        }
+
+        template<class U, std::enable_if_t<std::is_convertible_v<U*, T*>, int> = 0>
+        weak_ptr(const weak_ptr<U>& p) {
+            pin_guard guard;
+            _set(static_cast<T*>(p._load()));
+        }
+
+        weak_ptr(weak_ptr&& p) noexcept
+        : _slot(std::exchange(p._slot, nullptr)) {
+        }
+
+        ~weak_ptr() {
+            if (_slot) {
+                Weak_table::free(_slot);
+            }
+        }
+
+        weak_ptr& operator=(std::nullptr_t) noexcept {
+            reset();
+            return *this;
+        }
+
+        weak_ptr& operator=(const weak_ptr& p) {
+            if (this != &p) {
+                pin_guard guard;
+                _set(p._load());
+            }
+            return *this;
+        }
+
+        weak_ptr& operator=(weak_ptr&& p) noexcept {
+            std::swap(_slot, p._slot);
+            return *this;
+        }
+
+        template<class U, std::enable_if_t<std::is_convertible_v<U*, T*>, int> = 0>
+        weak_ptr& operator=(const root_ptr<U>& p) {
+            _set(static_cast<T*>(p.get()));
+            return *this;
+        }
+
+        template<class U, std::enable_if_t<std::is_convertible_v<U*, T*>, int> = 0>
+        weak_ptr& operator=(const tracked_ptr<U>& p) {
+            _set(static_cast<T*>(p.get()));
+            return *this;
+        }
+
+        void reset() noexcept {
+            if (_slot) {
+                _slot->pointer.store(nullptr, std::memory_order_release);
+            }
+        }
+
+        // the object is kept alive by the returned pointer, or nullptr if it is unreachable;
+        // objects first reached during the clearing of weak pointers are seen as unreachable
+        root_ptr<T> lock() const {
+            pin_guard guard;
+            return root_ptr<T>(_load());
+        }
+
+        bool expired() const noexcept {
+            pin_guard guard;
+            return !_load();
+        }
+
+        void swap(weak_ptr& p) noexcept {
+            std::swap(_slot, p._slot);
+        }
+
+    private:
+        // called within a pin
+        T* _load() const noexcept {
+            return (T*)Weak_table::load(_slot);
+        }
+
+        void _set(T* p) {
+            if (_slot) {
+                _slot->pointer.store(p, std::memory_order_release);
+            } else if (p) {
+                _slot = Weak_table::alloc(p);
+            }
+        }
+
+        Weak_table::Slot* _slot = {nullptr};
+
+        template<class> friend class weak_ptr;
+    };
+}